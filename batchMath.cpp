@@ -0,0 +1,324 @@
+#include "batchMath.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BATCH_MATH_X86
+#include <immintrin.h>
+#endif
+
+//same operations as glm::rotate, the identity products of glm::translate and glm::rotate are exact so they are skipped
+static void composeRange(const trsArrays* t, const unsigned int* indices, unsigned int begin, unsigned int end, glm::mat4* matrices) {
+    for (unsigned int k = begin; k < end; k++) {
+        unsigned int i = indices ? indices[k] : k;
+        float c = std::cos(t->angle[i]), s = std::sin(t->angle[i]);
+        float inverseLength = 1.f / std::sqrt(t->axisX[i] * t->axisX[i] + t->axisY[i] * t->axisY[i] + t->axisZ[i] * t->axisZ[i]);
+        float x = t->axisX[i] * inverseLength, y = t->axisY[i] * inverseLength, z = t->axisZ[i] * inverseLength;
+        float tx = (1.f - c) * x, ty = (1.f - c) * y, tz = (1.f - c) * z;
+        float sx = t->scaleX[i], sy = t->scaleY[i], sz = t->scaleZ[i];
+        glm::mat4& m = matrices[i];
+        m[0] = glm::vec4((c + tx * x) * sx, (tx * y + s * z) * sx, (tx * z - s * y) * sx, 0.f);
+        m[1] = glm::vec4((ty * x - s * z) * sy, (c + ty * y) * sy, (ty * z + s * x) * sy, 0.f);
+        m[2] = glm::vec4((tz * x + s * y) * sz, (tz * y - s * x) * sz, (c + tz * z) * sz, 0.f);
+        m[3] = glm::vec4(-t->positionX[i], -t->positionY[i], -t->positionZ[i], 1.f);
+    }
+}
+
+//the column by column product of glm's operator*
+static void multiplyRange(const glm::mat4& left, const glm::mat4* right, unsigned int begin, unsigned int end, glm::mat4* out) {
+    for (unsigned int i = begin; i < end; i++) {
+        out[i] = left * right[i];
+    }
+}
+
+//glm's quat * vec3 : v + ((uv * w) + uuv) * 2 with uv = cross(q.xyz, v) and uuv = cross(q.xyz, uv)
+static void rotateRange(const glm::quat& q, const float* x, const float* y, const float* z, unsigned int begin, unsigned int end, float* outX, float* outY, float* outZ) {
+    for (unsigned int i = begin; i < end; i++) {
+        float vx = x[i], vy = y[i], vz = z[i];
+        float uvx = q.y * vz - vy * q.z, uvy = q.z * vx - vz * q.x, uvz = q.x * vy - vx * q.y;
+        float uuvx = q.y * uvz - uvy * q.z, uuvy = q.z * uvx - uvz * q.x, uuvz = q.x * uvy - uvx * q.y;
+        outX[i] = vx + ((uvx * q.w) + uuvx) * 2.f;
+        outY[i] = vy + ((uvy * q.w) + uuvy) * 2.f;
+        outZ[i] = vz + ((uvz * q.w) + uuvz) * 2.f;
+    }
+}
+
+void composeModelMatricesScalar(const trsArrays* transforms, const unsigned int* indices, unsigned int count, glm::mat4* matrices) {
+    composeRange(transforms, indices, 0, count, matrices);
+}
+
+void multiplyMatricesScalar(const glm::mat4& left, const glm::mat4* right, unsigned int count, glm::mat4* out) {
+    multiplyRange(left, right, 0, count, out);
+}
+
+void rotateVectorsScalar(const glm::quat& rotation, const float* x, const float* y, const float* z, unsigned int count, float* outX, float* outY, float* outZ) {
+    rotateRange(rotation, x, y, z, 0, count, outX, outY, outZ);
+}
+
+#ifdef BATCH_MATH_X86
+
+//rows r[0..8) become columns
+__attribute__((target("avx2")))
+static inline void transpose8(__m256* r) {
+    __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]), t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]), t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]), t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]), t7 = _mm256_unpackhi_ps(r[6], r[7]);
+    __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)), u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)), u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)), u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)), u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+    r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+    r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+    r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+    r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+    r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+    r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+    r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 load8(const float* values, const unsigned int* indices, unsigned int k) {
+    if (indices) {
+        return _mm256_i32gather_ps(values, _mm256_loadu_si256((const __m256i*)(indices + k)), 4);
+    }
+    return _mm256_loadu_ps(values + k);
+}
+
+__attribute__((target("avx2")))
+static void composeAVX2(const trsArrays* t, const unsigned int* indices, unsigned int count, glm::mat4* matrices) {
+    const __m256 one = _mm256_set1_ps(1.f), zero = _mm256_setzero_ps(), signBit = _mm256_set1_ps(-0.f);
+    alignas(32) float cosines[8], sines[8];
+    unsigned int k = 0;
+    for (; k + 8 <= count; k += 8) {
+        //the trigonometry stays in the C library so that it matches glm to the bit
+        for (int lane = 0; lane < 8; lane++) {
+            float angle = t->angle[indices ? indices[k + lane] : k + lane];
+            cosines[lane] = std::cos(angle);
+            sines[lane] = std::sin(angle);
+        }
+        __m256 c = _mm256_load_ps(cosines), s = _mm256_load_ps(sines);
+        __m256 ax = load8(t->axisX, indices, k), ay = load8(t->axisY, indices, k), az = load8(t->axisZ, indices, k);
+        __m256 inverseLength = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, ax), _mm256_mul_ps(ay, ay)), _mm256_mul_ps(az, az))));
+        __m256 x = _mm256_mul_ps(ax, inverseLength), y = _mm256_mul_ps(ay, inverseLength), z = _mm256_mul_ps(az, inverseLength);
+        __m256 oneMinusC = _mm256_sub_ps(one, c);
+        __m256 tx = _mm256_mul_ps(oneMinusC, x), ty = _mm256_mul_ps(oneMinusC, y), tz = _mm256_mul_ps(oneMinusC, z);
+        __m256 sx = load8(t->scaleX, indices, k), sy = load8(t->scaleY, indices, k), sz = load8(t->scaleZ, indices, k);
+        //one register per matrix element, column major like glm
+        __m256 m[16];
+        m[0] = _mm256_mul_ps(_mm256_add_ps(c, _mm256_mul_ps(tx, x)), sx);
+        m[1] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(tx, y), _mm256_mul_ps(s, z)), sx);
+        m[2] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(tx, z), _mm256_mul_ps(s, y)), sx);
+        m[3] = zero;
+        m[4] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(ty, x), _mm256_mul_ps(s, z)), sy);
+        m[5] = _mm256_mul_ps(_mm256_add_ps(c, _mm256_mul_ps(ty, y)), sy);
+        m[6] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(ty, z), _mm256_mul_ps(s, x)), sy);
+        m[7] = zero;
+        m[8] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(tz, x), _mm256_mul_ps(s, y)), sz);
+        m[9] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(tz, y), _mm256_mul_ps(s, x)), sz);
+        m[10] = _mm256_mul_ps(_mm256_add_ps(c, _mm256_mul_ps(tz, z)), sz);
+        m[11] = zero;
+        m[12] = _mm256_xor_ps(load8(t->positionX, indices, k), signBit);
+        m[13] = _mm256_xor_ps(load8(t->positionY, indices, k), signBit);
+        m[14] = _mm256_xor_ps(load8(t->positionZ, indices, k), signBit);
+        m[15] = one;
+        //two 8x8 transposes give the first and last 8 floats of each matrix
+        transpose8(m);
+        transpose8(m + 8);
+        for (int lane = 0; lane < 8; lane++) {
+            float* out = &matrices[indices ? indices[k + lane] : k + lane][0][0];
+            _mm256_storeu_ps(out, m[lane]);
+            _mm256_storeu_ps(out + 8, m[8 + lane]);
+        }
+    }
+    composeRange(t, indices, k, count, matrices);
+}
+
+static inline __m128 load4(const float* values, const unsigned int* indices, unsigned int k) {
+    if (indices) {
+        return _mm_setr_ps(values[indices[k]], values[indices[k + 1]], values[indices[k + 2]], values[indices[k + 3]]);
+    }
+    return _mm_loadu_ps(values + k);
+}
+
+static void composeSSE(const trsArrays* t, const unsigned int* indices, unsigned int count, glm::mat4* matrices) {
+    const __m128 one = _mm_set1_ps(1.f), zero = _mm_setzero_ps(), signBit = _mm_set1_ps(-0.f);
+    alignas(16) float cosines[4], sines[4];
+    unsigned int k = 0;
+    for (; k + 4 <= count; k += 4) {
+        for (int lane = 0; lane < 4; lane++) {
+            float angle = t->angle[indices ? indices[k + lane] : k + lane];
+            cosines[lane] = std::cos(angle);
+            sines[lane] = std::sin(angle);
+        }
+        __m128 c = _mm_load_ps(cosines), s = _mm_load_ps(sines);
+        __m128 ax = load4(t->axisX, indices, k), ay = load4(t->axisY, indices, k), az = load4(t->axisZ, indices, k);
+        __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ax), _mm_mul_ps(ay, ay)), _mm_mul_ps(az, az))));
+        __m128 x = _mm_mul_ps(ax, inverseLength), y = _mm_mul_ps(ay, inverseLength), z = _mm_mul_ps(az, inverseLength);
+        __m128 oneMinusC = _mm_sub_ps(one, c);
+        __m128 tx = _mm_mul_ps(oneMinusC, x), ty = _mm_mul_ps(oneMinusC, y), tz = _mm_mul_ps(oneMinusC, z);
+        __m128 sx = load4(t->scaleX, indices, k), sy = load4(t->scaleY, indices, k), sz = load4(t->scaleZ, indices, k);
+        __m128 m[16];
+        m[0] = _mm_mul_ps(_mm_add_ps(c, _mm_mul_ps(tx, x)), sx);
+        m[1] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(tx, y), _mm_mul_ps(s, z)), sx);
+        m[2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(tx, z), _mm_mul_ps(s, y)), sx);
+        m[3] = zero;
+        m[4] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ty, x), _mm_mul_ps(s, z)), sy);
+        m[5] = _mm_mul_ps(_mm_add_ps(c, _mm_mul_ps(ty, y)), sy);
+        m[6] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ty, z), _mm_mul_ps(s, x)), sy);
+        m[7] = zero;
+        m[8] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(tz, x), _mm_mul_ps(s, y)), sz);
+        m[9] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(tz, y), _mm_mul_ps(s, x)), sz);
+        m[10] = _mm_mul_ps(_mm_add_ps(c, _mm_mul_ps(tz, z)), sz);
+        m[11] = zero;
+        m[12] = _mm_xor_ps(load4(t->positionX, indices, k), signBit);
+        m[13] = _mm_xor_ps(load4(t->positionY, indices, k), signBit);
+        m[14] = _mm_xor_ps(load4(t->positionZ, indices, k), signBit);
+        m[15] = one;
+        //each 4x4 transpose gives one column of the 4 matrices
+        for (int column = 0; column < 4; column++) {
+            _MM_TRANSPOSE4_PS(m[4 * column], m[4 * column + 1], m[4 * column + 2], m[4 * column + 3]);
+            for (int lane = 0; lane < 4; lane++) {
+                _mm_storeu_ps(&matrices[indices ? indices[k + lane] : k + lane][column][0], m[4 * column + lane]);
+            }
+        }
+    }
+    composeRange(t, indices, k, count, matrices);
+}
+
+//two result columns per register : the left columns are repeated in both halves, each right element is broadcast in its half
+__attribute__((target("avx2")))
+static void multiplyAVX2(const glm::mat4& left, const glm::mat4* right, unsigned int count, glm::mat4* out) {
+    __m256 l0 = _mm256_broadcast_ps((const __m128*)&left[0][0]);
+    __m256 l1 = _mm256_broadcast_ps((const __m128*)&left[1][0]);
+    __m256 l2 = _mm256_broadcast_ps((const __m128*)&left[2][0]);
+    __m256 l3 = _mm256_broadcast_ps((const __m128*)&left[3][0]);
+    for (unsigned int i = 0; i < count; i++) {
+        const float* r = &right[i][0][0];
+        __m256 columns01 = _mm256_loadu_ps(r), columns23 = _mm256_loadu_ps(r + 8);
+        __m256 result01 = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(l0, _mm256_shuffle_ps(columns01, columns01, _MM_SHUFFLE(0, 0, 0, 0))),
+            _mm256_mul_ps(l1, _mm256_shuffle_ps(columns01, columns01, _MM_SHUFFLE(1, 1, 1, 1)))),
+            _mm256_mul_ps(l2, _mm256_shuffle_ps(columns01, columns01, _MM_SHUFFLE(2, 2, 2, 2)))),
+            _mm256_mul_ps(l3, _mm256_shuffle_ps(columns01, columns01, _MM_SHUFFLE(3, 3, 3, 3))));
+        __m256 result23 = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(l0, _mm256_shuffle_ps(columns23, columns23, _MM_SHUFFLE(0, 0, 0, 0))),
+            _mm256_mul_ps(l1, _mm256_shuffle_ps(columns23, columns23, _MM_SHUFFLE(1, 1, 1, 1)))),
+            _mm256_mul_ps(l2, _mm256_shuffle_ps(columns23, columns23, _MM_SHUFFLE(2, 2, 2, 2)))),
+            _mm256_mul_ps(l3, _mm256_shuffle_ps(columns23, columns23, _MM_SHUFFLE(3, 3, 3, 3))));
+        float* o = &out[i][0][0];
+        _mm256_storeu_ps(o, result01);
+        _mm256_storeu_ps(o + 8, result23);
+    }
+}
+
+static void multiplySSE(const glm::mat4& left, const glm::mat4* right, unsigned int count, glm::mat4* out) {
+    __m128 l0 = _mm_loadu_ps(&left[0][0]), l1 = _mm_loadu_ps(&left[1][0]), l2 = _mm_loadu_ps(&left[2][0]), l3 = _mm_loadu_ps(&left[3][0]);
+    for (unsigned int i = 0; i < count; i++) {
+        __m128 result[4];
+        for (int column = 0; column < 4; column++) {
+            __m128 r = _mm_loadu_ps(&right[i][column][0]);
+            result[column] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(l0, _mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 0))),
+                _mm_mul_ps(l1, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1)))),
+                _mm_mul_ps(l2, _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 2, 2, 2)))),
+                _mm_mul_ps(l3, _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3))));
+        }
+        //stored once all columns are read, out can be right
+        for (int column = 0; column < 4; column++) {
+            _mm_storeu_ps(&out[i][column][0], result[column]);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void rotateAVX2(const glm::quat& q, const float* x, const float* y, const float* z, unsigned int count, float* outX, float* outY, float* outZ) {
+    __m256 qx = _mm256_set1_ps(q.x), qy = _mm256_set1_ps(q.y), qz = _mm256_set1_ps(q.z), qw = _mm256_set1_ps(q.w), two = _mm256_set1_ps(2.f);
+    unsigned int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+        __m256 uvx = _mm256_sub_ps(_mm256_mul_ps(qy, vz), _mm256_mul_ps(vy, qz));
+        __m256 uvy = _mm256_sub_ps(_mm256_mul_ps(qz, vx), _mm256_mul_ps(vz, qx));
+        __m256 uvz = _mm256_sub_ps(_mm256_mul_ps(qx, vy), _mm256_mul_ps(vx, qy));
+        __m256 uuvx = _mm256_sub_ps(_mm256_mul_ps(qy, uvz), _mm256_mul_ps(uvy, qz));
+        __m256 uuvy = _mm256_sub_ps(_mm256_mul_ps(qz, uvx), _mm256_mul_ps(uvz, qx));
+        __m256 uuvz = _mm256_sub_ps(_mm256_mul_ps(qx, uvy), _mm256_mul_ps(uvx, qy));
+        _mm256_storeu_ps(outX + i, _mm256_add_ps(vx, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(uvx, qw), uuvx), two)));
+        _mm256_storeu_ps(outY + i, _mm256_add_ps(vy, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(uvy, qw), uuvy), two)));
+        _mm256_storeu_ps(outZ + i, _mm256_add_ps(vz, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(uvz, qw), uuvz), two)));
+    }
+    rotateRange(q, x, y, z, i, count, outX, outY, outZ);
+}
+
+static void rotateSSE(const glm::quat& q, const float* x, const float* y, const float* z, unsigned int count, float* outX, float* outY, float* outZ) {
+    __m128 qx = _mm_set1_ps(q.x), qy = _mm_set1_ps(q.y), qz = _mm_set1_ps(q.z), qw = _mm_set1_ps(q.w), two = _mm_set1_ps(2.f);
+    unsigned int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+        __m128 uvx = _mm_sub_ps(_mm_mul_ps(qy, vz), _mm_mul_ps(vy, qz));
+        __m128 uvy = _mm_sub_ps(_mm_mul_ps(qz, vx), _mm_mul_ps(vz, qx));
+        __m128 uvz = _mm_sub_ps(_mm_mul_ps(qx, vy), _mm_mul_ps(vx, qy));
+        __m128 uuvx = _mm_sub_ps(_mm_mul_ps(qy, uvz), _mm_mul_ps(uvy, qz));
+        __m128 uuvy = _mm_sub_ps(_mm_mul_ps(qz, uvx), _mm_mul_ps(uvz, qx));
+        __m128 uuvz = _mm_sub_ps(_mm_mul_ps(qx, uvy), _mm_mul_ps(uvx, qy));
+        _mm_storeu_ps(outX + i, _mm_add_ps(vx, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(uvx, qw), uuvx), two)));
+        _mm_storeu_ps(outY + i, _mm_add_ps(vy, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(uvy, qw), uuvy), two)));
+        _mm_storeu_ps(outZ + i, _mm_add_ps(vz, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(uvz, qw), uuvz), two)));
+    }
+    rotateRange(q, x, y, z, i, count, outX, outY, outZ);
+}
+
+static bool hasAVX2() {
+    static bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+#endif
+
+void composeModelMatrices(const trsArrays* transforms, const unsigned int* indices, unsigned int count, glm::mat4* matrices) {
+#ifdef BATCH_MATH_X86
+    if (hasAVX2()) {
+        composeAVX2(transforms, indices, count, matrices);
+    }
+    else {
+        composeSSE(transforms, indices, count, matrices);
+    }
+#else
+    composeRange(transforms, indices, 0, count, matrices);
+#endif
+}
+
+void multiplyMatrices(const glm::mat4& left, const glm::mat4* right, unsigned int count, glm::mat4* out) {
+#ifdef BATCH_MATH_X86
+    if (hasAVX2()) {
+        multiplyAVX2(left, right, count, out);
+    }
+    else {
+        multiplySSE(left, right, count, out);
+    }
+#else
+    multiplyRange(left, right, 0, count, out);
+#endif
+}
+
+void rotateVectors(const glm::quat& rotation, const float* x, const float* y, const float* z, unsigned int count, float* outX, float* outY, float* outZ) {
+#ifdef BATCH_MATH_X86
+    if (hasAVX2()) {
+        rotateAVX2(rotation, x, y, z, count, outX, outY, outZ);
+    }
+    else {
+        rotateSSE(rotation, x, y, z, count, outX, outY, outZ);
+    }
+#else
+    rotateRange(rotation, x, y, z, 0, count, outX, outY, outZ);
+#endif
+}
+
+const char* getBatchMathKernelName() {
+#ifdef BATCH_MATH_X86
+    return hasAVX2() ? "AVX2" : "SSE";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+//position, scale and axis angle rotation of many transforms in structure of arrays form, as kept by transformStore
+struct trsArrays {
+    const float* positionX;
+    const float* positionY;
+    const float* positionZ;
+    const float* scaleX;
+    const float* scaleY;
+    const float* scaleZ;
+    const float* axisX;
+    const float* axisY;
+    const float* axisZ;
+    const float* angle;
+}typedef trsArrays;
+
+//all the kernels use AVX2 (8 items per iteration) when the cpu has it, SSE (4) otherwise, scalar on other architectures
+//they do the same operations in the same order as glm, so the results are bit identical to it
+//(composeModelMatrices writes 0 where the identity products of glm can give -0)
+
+//matrices[i] = translate(-position) * rotate(angle, axis) * scale(scale) of the transforms indices[0 .. count), or [0, count) when indices is NULL
+void composeModelMatrices(const trsArrays* transforms, const unsigned int* indices, unsigned int count, glm::mat4* matrices);
+void composeModelMatricesScalar(const trsArrays* transforms, const unsigned int* indices, unsigned int count, glm::mat4* matrices);
+//out[i] = left * right[i], out can be right
+void multiplyMatrices(const glm::mat4& left, const glm::mat4* right, unsigned int count, glm::mat4* out);
+void multiplyMatricesScalar(const glm::mat4& left, const glm::mat4* right, unsigned int count, glm::mat4* out);
+//rotation * v for count vectors in structure of arrays form, the outputs can be the inputs
+void rotateVectors(const glm::quat& rotation, const float* x, const float* y, const float* z, unsigned int count, float* outX, float* outY, float* outZ);
+void rotateVectorsScalar(const glm::quat& rotation, const float* x, const float* y, const float* z, unsigned int count, float* outX, float* outY, float* outZ);
+//name of the kernels used on this cpu
+const char* getBatchMathKernelName();
@@ -0,0 +1,566 @@
+#include "benchmarks.h"
+#include "objLoader.h"
+#include "meshCache.h"
+#include "frustum.h"
+#include "cullingSoA.h"
+#include "sceneBvh.h"
+#include "meshBvh.h"
+#include "transformStore.h"
+#include "batchMath.h"
+#include "gameItem.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <cstring>
+#include <random>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+using namespace std;
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//a gridSize x gridSize wavy terrain with texture coordinates, normals and quad faces
+static string generateObjGrid(int gridSize) {
+    string text;
+    text.reserve((size_t)gridSize * gridSize * 130);
+    char line[128];
+    for (int j = 0; j < gridSize; j++) {
+        for (int i = 0; i < gridSize; i++) {
+            float x = (float)i / gridSize, z = (float)j / gridSize;
+            snprintf(line, sizeof(line), "v %f %f %f\n", x * 100.f, 0.5f * (x - z) * (x + z), z * 100.f);
+            text += line;
+        }
+    }
+    for (int j = 0; j < gridSize; j++) {
+        for (int i = 0; i < gridSize; i++) {
+            snprintf(line, sizeof(line), "vt %f %f\n", (float)i / (gridSize - 1), (float)j / (gridSize - 1));
+            text += line;
+        }
+    }
+    for (int j = 0; j < gridSize; j++) {
+        for (int i = 0; i < gridSize; i++) {
+            snprintf(line, sizeof(line), "vn %.4f %.4f %.4f\n", 0.01f * i / gridSize, 0.9999f, -0.01f * j / gridSize);
+            text += line;
+        }
+    }
+    for (int j = 0; j < gridSize - 1; j++) {
+        for (int i = 0; i < gridSize - 1; i++) {
+            int a = j * gridSize + i + 1, b = a + 1, c = a + gridSize + 1, d = a + gridSize;
+            snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+            text += line;
+        }
+    }
+    return text;
+}
+
+void benchmarkObjParsing() {
+    int gridSizes[] = { 128, 512, 1024 };
+    for (int gridSize : gridSizes) {
+        string text = generateObjGrid(gridSize);
+        double megaBytes = text.size() / (1024. * 1024.);
+
+        objData data;
+        auto start = chrono::steady_clock::now();
+        parseObj(text.data(), text.data() + text.size(), &data);
+        double parseTime = secondsSince(start);
+
+        vector<float> vertices;
+        vector<unsigned int> indices;
+        meshWeldStats weldStats;
+        buildInterleavedMesh(&data, &vertices, &indices, &weldStats);
+
+        unsigned int triangleCount = data.getTriangleCount();
+        printf("obj parsing %dx%d grid : %.1f MB, %u triangles\n", gridSize, gridSize, megaBytes, triangleCount);
+        printf("    parse : %.2f ms, %.1f MB/s, %.2f M triangles/s\n", parseTime * 1000., megaBytes / parseTime, triangleCount / parseTime / 1e6);
+        printf("    welding : %.2f ms, %u corners -> %u vertices (x%.2f), %.1f MB of VBO saved\n", weldStats.seconds * 1000.,
+            weldStats.cornerCount, weldStats.vertexCount, weldStats.getDedupRatio(),
+            (weldStats.cornerCount - weldStats.vertexCount) * 5 * sizeof(float) / (1024. * 1024.));
+
+        //the chunked parser must give the exact same streams
+        unsigned int coreCount = max(1u, thread::hardware_concurrency());
+        for (unsigned int threadCount = 2; threadCount <= 2 * coreCount; threadCount *= 2) {
+            objData parallelData;
+            start = chrono::steady_clock::now();
+            parseObjParallel(text.data(), text.data() + text.size(), &parallelData, threadCount);
+            double parallelTime = secondsSince(start);
+            bool identical = parallelData.positions == data.positions && parallelData.texCoords == data.texCoords
+                && parallelData.normals == data.normals && parallelData.faceIndices == data.faceIndices;
+            printf("    parse with %u threads : %.2f ms, %.1f MB/s, x%.2f %s\n", threadCount, parallelTime * 1000., megaBytes / parallelTime,
+                parseTime / parallelTime, identical ? "" : "(OUTPUT DIFFERS)");
+        }
+    }
+}
+
+//the buffer uploads of gameItem::loadMesh, glBufferData reads every page of the given arrays
+static void uploadMeshBuffers(const float* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const float* normals) {
+    unsigned int buffers[3];
+    glGenBuffers(3, buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(float), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[2]);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount / VERTEX_SIZE * NORMAL_SIZE * sizeof(float), normals, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glFinish();
+    glDeleteBuffers(3, buffers);
+}
+
+//startup cost of an obj, as in gameItem::loadMeshFromObjFile : cold (parse, weld, write the cache and upload) against
+//warm (map the cache and upload from the mapping)
+void benchmarkMeshCache() {
+    const char* fileName = "./benchmark.obj";
+    string text = generateObjGrid(1024);
+    FILE* file = fopen(fileName, "wb");
+    if (!file) {
+        printf("mesh cache benchmark : cannot write %s\n", fileName);
+        return;
+    }
+    fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+    remove(getMeshCacheFileName(fileName).c_str());
+
+    auto start = chrono::steady_clock::now();
+    objData data;
+    loadObjFileParallel(fileName, &data);
+    vector<float> vertices;
+    vector<unsigned int> indices;
+    vector<float> normals;
+    vector<unsigned int> splitSources;
+    buildInterleavedMesh(&data, &vertices, &indices, NULL, &normals, &splitSources);
+    if (normals.empty()) {
+        gameItem::computeVertexNormals(&vertices, &indices, &normals, &splitSources);
+    }
+    writeMeshCache(fileName, vertices.data(), vertices.size(), indices.data(), indices.size(), normals.data(), normals.size(),
+        splitSources.data(), splitSources.size());
+    uploadMeshBuffers(vertices.data(), vertices.size(), indices.data(), indices.size(), normals.data());
+    double coldTime = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    meshCacheMapping cache;
+    bool hit = openMeshCache(fileName, &cache);
+    if (hit) {
+        uploadMeshBuffers(cache.vertices, cache.vertexCount, cache.indices, cache.indexCount, cache.normals);
+    }
+    double warmTime = secondsSince(start);
+    bool identical = hit && cache.vertexCount == vertices.size() && cache.indexCount == indices.size()
+        && memcmp(cache.vertices, vertices.data(), vertices.size() * sizeof(float)) == 0
+        && memcmp(cache.indices, indices.data(), indices.size() * sizeof(unsigned int)) == 0
+        && cache.normalCount == normals.size() && memcmp(cache.normals, normals.data(), normals.size() * sizeof(float)) == 0;
+    closeMeshCache(&cache);
+
+    printf("mesh cache, %.1f MB obj, %zu triangles\n", text.size() / (1024. * 1024.), indices.size() / 3);
+    printf("    cold obj load : %.2f ms\n", coldTime * 1000.);
+    printf("    warm cache load : %.2f ms, x%.1f %s\n", warmTime * 1000., coldTime / warmTime, identical ? "" : "(CACHE MISS OR DIFFERENT DATA)");
+    remove(getMeshCacheFileName(fileName).c_str());
+    remove(fileName);
+}
+
+//culling kernel against the scalar glm path, random spheres in a 200m cube around a camera at the origin
+void benchmarkCulling() {
+    glm::mat4 viewProjMatrix = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 100.f)
+        * glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+    frustum viewFrustum;
+    viewFrustum.extract(viewProjMatrix);
+    mt19937 random(42);
+    uniform_real_distribution<float> position(-100.f, 100.f), size(0.1f, 2.f);
+    unsigned int itemCounts[] = { 10000, 100000, 1000000 };
+    for (unsigned int itemCount : itemCounts) {
+        vector<glm::vec3> centers(itemCount);
+        vector<float> radii(itemCount);
+        boundsSoA bounds;
+        bounds.resize(itemCount);
+        for (unsigned int i = 0; i < itemCount; i++) {
+            centers[i] = glm::vec3(position(random), position(random), position(random));
+            radii[i] = size(random);
+            bounds.set(i, centers[i], radii[i]);
+        }
+        //best of a few runs, the first ones warm the caches
+        int runs = max(3, (int)(10000000 / itemCount));
+        vector<unsigned int> scalarVisible, kernelVisible, soaScalarVisible;
+        double scalarTime = 1e9, soaScalarTime = 1e9, kernelTime = 1e9;
+        for (int run = 0; run < runs; run++) {
+            auto start = chrono::steady_clock::now();
+            scalarVisible.clear();
+            for (unsigned int i = 0; i < itemCount; i++) {
+                if (viewFrustum.intersectsSphere(centers[i], radii[i])) {
+                    scalarVisible.push_back(i);
+                }
+            }
+            scalarTime = min(scalarTime, secondsSince(start));
+
+            start = chrono::steady_clock::now();
+            cullSpheresScalar(&viewFrustum, &bounds, &soaScalarVisible);
+            soaScalarTime = min(soaScalarTime, secondsSince(start));
+
+            start = chrono::steady_clock::now();
+            cullSpheres(&viewFrustum, &bounds, &kernelVisible);
+            kernelTime = min(kernelTime, secondsSince(start));
+        }
+        bool identical = scalarVisible == kernelVisible && scalarVisible == soaScalarVisible;
+        printf("frustum culling %u spheres, %zu visible\n", itemCount, scalarVisible.size());
+        printf("    glm scalar : %.3f ms, %.1f M spheres/s\n", scalarTime * 1000., itemCount / scalarTime / 1e6);
+        printf("    SoA scalar : %.3f ms, x%.2f\n", soaScalarTime * 1000., scalarTime / soaScalarTime);
+        printf("    SoA %s : %.3f ms, x%.2f %s\n", getCullingKernelName(), kernelTime * 1000., scalarTime / kernelTime,
+            identical ? "" : "(OUTPUT DIFFERS)");
+    }
+}
+
+//build, refit and queries of the scene bvh over 1M random boxes, checked against linear scans
+void benchmarkSceneBvh() {
+    unsigned int itemCount = 1000000;
+    mt19937 random(7);
+    uniform_real_distribution<float> position(-500.f, 500.f), size(0.1f, 2.f), offset(-1.f, 1.f);
+    vector<glm::vec3> itemsMin(itemCount), itemsMax(itemCount);
+    for (unsigned int i = 0; i < itemCount; i++) {
+        glm::vec3 center = glm::vec3(position(random), position(random), position(random));
+        glm::vec3 halfExtents = glm::vec3(size(random), size(random), size(random));
+        itemsMin[i] = center - halfExtents;
+        itemsMax[i] = center + halfExtents;
+    }
+    sceneBvh bvh;
+    auto start = chrono::steady_clock::now();
+    bvh.build(itemsMin, itemsMax);
+    printf("scene bvh, %u items, %zu nodes\n", itemCount, bvh.nodes.size());
+    printf("    build : %.2f ms\n", secondsSince(start) * 1000.);
+
+    //a few items moving a little, then most of them
+    unsigned int movedCounts[] = { 100, 10000, 500000 };
+    for (unsigned int movedCount : movedCounts) {
+        for (unsigned int i = 0; i < movedCount; i++) {
+            unsigned int item = random() % itemCount;
+            glm::vec3 move = glm::vec3(offset(random), offset(random), offset(random));
+            itemsMin[item] += move;
+            itemsMax[item] += move;
+            bvh.setItemBounds(item, itemsMin[item], itemsMax[item]);
+        }
+        start = chrono::steady_clock::now();
+        bvh.refit();
+        printf("    refit after %u moves : %.3f ms, %u nodes updated\n", movedCount, secondsSince(start) * 1000., bvh.refittedNodeCount);
+    }
+
+    frustum viewFrustum;
+    viewFrustum.extract(glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 300.f)
+        * glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f)));
+    vector<unsigned int> bvhVisible, linearVisible;
+    start = chrono::steady_clock::now();
+    bvh.cullFrustum(&viewFrustum, &bvhVisible);
+    double bvhTime = secondsSince(start);
+    start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < itemCount; i++) {
+        if (viewFrustum.intersectsBox(0.5f * (itemsMin[i] + itemsMax[i]), 0.5f * (itemsMax[i] - itemsMin[i]))) {
+            linearVisible.push_back(i);
+        }
+    }
+    double linearTime = secondsSince(start);
+    sort(bvhVisible.begin(), bvhVisible.end());
+    printf("    frustum query : %.3f ms, %zu visible, linear scan %.3f ms, x%.1f %s\n", bvhTime * 1000., bvhVisible.size(),
+        linearTime * 1000., linearTime / bvhTime, bvhVisible == linearVisible ? "" : "(OUTPUT DIFFERS)");
+
+    //rays from the origin in random directions, the linear scan only runs on the first ones
+    int rayCount = 10000, linearRayCount = 20, mismatches = 0, hits = 0;
+    vector<glm::vec3> directions(rayCount);
+    for (int r = 0; r < rayCount; r++) {
+        directions[r] = glm::normalize(glm::vec3(offset(random), offset(random), offset(random)));
+    }
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < rayCount; r++) {
+        float distance;
+        hits += bvh.raycast(glm::vec3(0.f), directions[r], &distance) != -1;
+    }
+    bvhTime = secondsSince(start) / rayCount;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < linearRayCount; r++) {
+        glm::vec3 inverseDirection = 1.f / directions[r];
+        float nearest = FLT_MAX;
+        for (unsigned int i = 0; i < itemCount; i++) {
+            glm::vec3 t0 = (itemsMin[i]) * inverseDirection, t1 = (itemsMax[i]) * inverseDirection;
+            glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+            float entry = max(max(tNear.x, tNear.y), max(tNear.z, 0.f)), exit = min(min(tFar.x, tFar.y), tFar.z);
+            if (entry <= exit && entry < nearest) {
+                nearest = entry;
+            }
+        }
+        float distance = FLT_MAX;
+        bvh.raycast(glm::vec3(0.f), directions[r], &distance);
+        mismatches += distance != nearest;
+    }
+    linearTime = secondsSince(start) / linearRayCount;
+    printf("    raycast : %.2f us per ray, %d / %d hits, linear scan %.2f ms per ray, x%.0f %s\n", bvhTime * 1e6, hits, rayCount,
+        linearTime * 1000., linearTime / bvhTime, mismatches == 0 ? "" : "(NEAREST HIT DIFFERS)");
+}
+
+//triangle bvh of a 2M triangles terrain : build with one thread and with all cores, then rays against a brute force loop
+void benchmarkMeshBvh() {
+    objData data;
+    string text = generateObjGrid(1024);
+    parseObj(text.data(), text.data() + text.size(), &data);
+    vector<float> vertices;
+    vector<unsigned int> indices;
+    buildInterleavedMesh(&data, &vertices, &indices);
+    unsigned int triangleCount = indices.size() / 3;
+    printf("mesh bvh, %u triangles\n", triangleCount);
+
+    meshBvh bvh;
+    bvh.build(vertices.data(), 5, indices.data(), indices.size(), 1);
+    double singleThreadTime = bvh.buildSeconds;
+    printf("    build with 1 thread : %.2f ms, %zu nodes\n", singleThreadTime * 1000., bvh.nodes.size());
+    bvh.build(vertices.data(), 5, indices.data(), indices.size());
+    printf("    build with %u threads : %.2f ms, x%.2f\n", max(1u, thread::hardware_concurrency()), bvh.buildSeconds * 1000., singleThreadTime / bvh.buildSeconds);
+
+    //rays shot down at the terrain from random points above it
+    mt19937 random(3);
+    uniform_real_distribution<float> position(0.f, 100.f), slope(-0.3f, 0.3f);
+    int rayCount = 100000, bruteForceRayCount = 10, hits = 0, mismatches = 0;
+    vector<glm::vec3> origins(rayCount), directions(rayCount);
+    for (int r = 0; r < rayCount; r++) {
+        origins[r] = glm::vec3(position(random), 50.f, position(random));
+        directions[r] = glm::vec3(slope(random), -1.f, slope(random));
+    }
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < rayCount; r++) {
+        meshRayHit hit;
+        hits += bvh.intersect(origins[r], directions[r], FLT_MAX, &hit);
+    }
+    double bvhTime = secondsSince(start) / rayCount;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < bruteForceRayCount; r++) {
+        float nearest = FLT_MAX;
+        for (unsigned int t = 0; t < triangleCount; t++) {
+            glm::vec3 a = glm::vec3(vertices[5 * indices[3 * t]], vertices[5 * indices[3 * t] + 1], vertices[5 * indices[3 * t] + 2]);
+            glm::vec3 b = glm::vec3(vertices[5 * indices[3 * t + 1]], vertices[5 * indices[3 * t + 1] + 1], vertices[5 * indices[3 * t + 1] + 2]);
+            glm::vec3 c = glm::vec3(vertices[5 * indices[3 * t + 2]], vertices[5 * indices[3 * t + 2] + 1], vertices[5 * indices[3 * t + 2] + 2]);
+            glm::vec3 edge1 = b - a, edge2 = c - a, p = glm::cross(directions[r], edge2);
+            float determinant = glm::dot(edge1, p);
+            if (determinant == 0.f) continue;
+            glm::vec3 s = origins[r] - a, q = glm::cross(s, edge1);
+            float u = glm::dot(s, p) / determinant, v = glm::dot(directions[r], q) / determinant, distance = glm::dot(edge2, q) / determinant;
+            if (u >= 0.f && v >= 0.f && u + v <= 1.f && distance > 0.f && distance < nearest) {
+                nearest = distance;
+            }
+        }
+        meshRayHit hit;
+        bool found = bvh.intersect(origins[r], directions[r], FLT_MAX, &hit);
+        //both loops round differently, the distances only have to agree closely
+        mismatches += found ? fabs(hit.distance - nearest) > 1e-3f * nearest : nearest != FLT_MAX;
+    }
+    double bruteForceTime = secondsSince(start) / bruteForceRayCount;
+    printf("    ray query : %.2f us per ray, %d / %d hits, brute force %.2f ms per ray, x%.0f %s\n", bvhTime * 1e6, hits, rayCount,
+        bruteForceTime * 1000., bruteForceTime / bvhTime, mismatches == 0 ? "" : "(NEAREST HIT DIFFERS)");
+}
+
+//the old layout : transform fields in the middle of the cold data of each item
+struct benchmarkItem {
+    const char* name;
+    unsigned int* indices;
+    unsigned int indexCount;
+    float* vertices;
+    unsigned int vertexCount;
+    float* normals;
+    unsigned int texture;
+    glm::vec3 position;
+    glm::vec3 scale;
+    glm::vec3 rotationAxis;
+    float rotationAngle;
+    unsigned int VAO, VBO, EBO, normalVBO;
+    glm::vec4 edgesColor;
+    glm::vec3 boundsMin, boundsMax, boundsCenter;
+    float boundsRadius;
+}typedef benchmarkItem;
+
+//model matrices of 100k items, glm calls on an array of items against the batched pass over the transform store
+void benchmarkTransforms() {
+    int itemCount = 100000, repeats = 20;
+    mt19937 random(5);
+    uniform_real_distribution<float> position(-100.f, 100.f), size(0.1f, 2.f), angle(-3.f, 3.f);
+    vector<benchmarkItem> items(itemCount);
+    transformStore transforms;
+    for (int i = 0; i < itemCount; i++) {
+        benchmarkItem* item = &items[i];
+        item->position = glm::vec3(position(random), position(random), position(random));
+        item->scale = glm::vec3(size(random), size(random), size(random));
+        item->rotationAxis = glm::vec3(angle(random), angle(random), angle(random));
+        item->rotationAngle = angle(random);
+        transforms.create(item->position, item->scale, item->rotationAxis, item->rotationAngle);
+    }
+    vector<glm::mat4> itemMatrices(itemCount), storeMatrices(itemCount);
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        for (int i = 0; i < itemCount; i++) {
+            glm::mat4 modelMatrix = glm::translate(glm::mat4(1.f), -items[i].position);
+            modelMatrix = glm::rotate(modelMatrix, items[i].rotationAngle, items[i].rotationAxis);
+            itemMatrices[i] = glm::scale(modelMatrix, items[i].scale);
+        }
+    }
+    double itemTime = secondsSince(start) / repeats;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        transforms.buildModelMatrices(storeMatrices.data());
+    }
+    double storeTime = secondsSince(start) / repeats;
+    //a mostly static world : 1% of the items move each frame, only their matrices are recomputed
+    transforms.updateModelMatrices();
+    double cachedTime = 0.;
+    unsigned int recomputed = 0;
+    for (int r = 0; r < repeats; r++) {
+        for (int i = r; i < itemCount; i += 100) {
+            items[i].position.y += 1.f;
+            transforms.setPosition(i, items[i].position);
+        }
+        start = chrono::steady_clock::now();
+        recomputed += transforms.updateModelMatrices();
+        cachedTime += secondsSince(start);
+    }
+    cachedTime /= repeats;
+    //compared by value, glm can give -0 where the store writes 0
+    bool identical = itemMatrices == storeMatrices;
+    printf("model matrices, %d items\n", itemCount);
+    printf("    array of items : %.2f ms\n", itemTime * 1000.);
+    printf("    transform store : %.2f ms, x%.2f %s\n", storeTime * 1000., itemTime / storeTime, identical ? "" : "(MATRICES DIFFER)");
+    printf("    cached with 1%% moving : %.3f ms, %u matrices recomputed per frame, x%.0f\n", cachedTime * 1000., recomputed / repeats, itemTime / cachedTime);
+}
+
+//times the updates of a hierarchy that is already up to date : all of it, the subtree of the root and the subtree of a transform at 90%
+static void timeHierarchyUpdates(const char* name, transformStore* transforms, vector<transformHandle>* nodes) {
+    auto start = chrono::steady_clock::now();
+    transforms->updateModelMatrices();
+    double buildTime = secondsSince(start);
+    transformHandle root = (*nodes)[0], late = (*nodes)[nodes->size() * 9 / 10];
+    transforms->setRotation(root, glm::vec3(0.f, 1.f, 0.f), 0.5f);
+    start = chrono::steady_clock::now();
+    unsigned int rootCount = transforms->updateModelMatrices();
+    double rootTime = secondsSince(start);
+    transforms->setPosition(late, glm::vec3(1.f, 0.f, 0.f));
+    start = chrono::steady_clock::now();
+    unsigned int lateCount = transforms->updateModelMatrices();
+    double lateTime = secondsSince(start);
+    start = chrono::steady_clock::now();
+    transforms->updateModelMatrices();
+    double cleanTime = secondsSince(start);
+    printf("    %s : first update %.2f ms, root moved %.2f ms (%u matrices), node at 90%% moved %.3f ms (%u matrices), nothing moved %.4f ms\n",
+        name, buildTime * 1000., rootTime * 1000., rootCount, lateTime * 1000., lateCount, cleanTime * 1000.);
+}
+
+//world matrix propagation over 1M transforms : one chain, one root with every other node as its child, and a 4-ary tree
+void benchmarkTransformHierarchy() {
+    unsigned int nodeCount = 1000000;
+    printf("transform hierarchy, %u nodes\n", nodeCount);
+    glm::vec3 step = glm::vec3(-0.01f, 0.f, 0.f), axis = glm::vec3(0.f, 0.f, 1.f);
+    vector<transformHandle> nodes(nodeCount);
+    {
+        transformStore transforms;
+        nodes[0] = transforms.create();
+        for (unsigned int i = 1; i < nodeCount; i++) {
+            nodes[i] = transforms.create(step, glm::vec3(1.f), axis, 0.001f, nodes[i - 1]);
+        }
+        timeHierarchyUpdates("deep", &transforms, &nodes);
+    }
+    {
+        transformStore transforms;
+        nodes[0] = transforms.create();
+        for (unsigned int i = 1; i < nodeCount; i++) {
+            nodes[i] = transforms.create(glm::vec3(-(float)(i % 1000), 0.f, -(float)(i / 1000)), glm::vec3(1.f), axis, 0.001f * i, nodes[0]);
+        }
+        timeHierarchyUpdates("wide", &transforms, &nodes);
+    }
+    {
+        transformStore transforms;
+        nodes[0] = transforms.create();
+        for (unsigned int i = 1; i < nodeCount; i++) {
+            nodes[i] = transforms.create(step, glm::vec3(0.9f), axis, 0.3f * (i % 4), nodes[(i - 1) / 4]);
+        }
+        timeHierarchyUpdates("4-ary tree", &transforms, &nodes);
+    }
+}
+
+//the batch kernels against their scalar versions on 100k items, and their results against glm
+void benchmarkBatchMath() {
+    unsigned int count = 100000;
+    int repeats = 20;
+    mt19937 random(11);
+    uniform_real_distribution<float> position(-100.f, 100.f), size(0.1f, 2.f), angle(-3.f, 3.f);
+    vector<float> fields[10];
+    for (int f = 0; f < 10; f++) {
+        fields[f].resize(count);
+        for (float& value : fields[f]) {
+            value = f < 3 ? position(random) : f < 6 ? size(random) : angle(random);
+        }
+    }
+    trsArrays transforms = { fields[0].data(), fields[1].data(), fields[2].data(), fields[3].data(), fields[4].data(), fields[5].data(),
+        fields[6].data(), fields[7].data(), fields[8].data(), fields[9].data() };
+    printf("batch math, %u items, %s kernels\n", count, getBatchMathKernelName());
+
+    vector<glm::mat4> scalarMatrices(count), kernelMatrices(count), glmMatrices(count);
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        composeModelMatricesScalar(&transforms, NULL, count, scalarMatrices.data());
+    }
+    double scalarTime = secondsSince(start) / repeats;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        composeModelMatrices(&transforms, NULL, count, kernelMatrices.data());
+    }
+    double kernelTime = secondsSince(start) / repeats;
+    for (unsigned int i = 0; i < count; i++) {
+        glm::mat4 modelMatrix = glm::translate(glm::mat4(1.f), -glm::vec3(fields[0][i], fields[1][i], fields[2][i]));
+        modelMatrix = glm::rotate(modelMatrix, fields[9][i], glm::vec3(fields[6][i], fields[7][i], fields[8][i]));
+        glmMatrices[i] = glm::scale(modelMatrix, glm::vec3(fields[3][i], fields[4][i], fields[5][i]));
+    }
+    //compared by value, glm can give -0 where the kernels write 0
+    bool identical = kernelMatrices == glmMatrices && memcmp(kernelMatrices.data(), scalarMatrices.data(), count * sizeof(glm::mat4)) == 0;
+    printf("    compose TRS : scalar %.2f ms, kernel %.2f ms, x%.2f %s\n", scalarTime * 1000., kernelTime * 1000., scalarTime / kernelTime,
+        identical ? "" : "(DIFFERS FROM GLM)");
+
+    glm::mat4 viewProjMatrix = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 100.f)
+        * glm::lookAt(glm::vec3(3.f, 2.f, 1.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+    vector<glm::mat4> products(count);
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        multiplyMatricesScalar(viewProjMatrix, glmMatrices.data(), count, products.data());
+    }
+    scalarTime = secondsSince(start) / repeats;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        multiplyMatrices(viewProjMatrix, glmMatrices.data(), count, kernelMatrices.data());
+    }
+    kernelTime = secondsSince(start) / repeats;
+    identical = true;
+    for (unsigned int i = 0; i < count; i++) {
+        glm::mat4 product = viewProjMatrix * glmMatrices[i];
+        identical = identical && memcmp(&product, &kernelMatrices[i], sizeof(glm::mat4)) == 0;
+    }
+    printf("    view projection * model : scalar %.2f ms, kernel %.2f ms, x%.2f %s\n", scalarTime * 1000., kernelTime * 1000., scalarTime / kernelTime,
+        identical ? "" : "(DIFFERS FROM GLM)");
+
+    glm::quat rotation = glm::angleAxis(0.7f, glm::normalize(glm::vec3(1.f, 2.f, 3.f)));
+    vector<float> outX(count), outY(count), outZ(count);
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        rotateVectorsScalar(rotation, fields[0].data(), fields[1].data(), fields[2].data(), count, outX.data(), outY.data(), outZ.data());
+    }
+    scalarTime = secondsSince(start) / repeats;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        rotateVectors(rotation, fields[0].data(), fields[1].data(), fields[2].data(), count, outX.data(), outY.data(), outZ.data());
+    }
+    kernelTime = secondsSince(start) / repeats;
+    identical = true;
+    for (unsigned int i = 0; i < count; i++) {
+        glm::vec3 rotated = rotation * glm::vec3(fields[0][i], fields[1][i], fields[2][i]);
+        identical = identical && memcmp(&rotated.x, &outX[i], sizeof(float)) == 0 && memcmp(&rotated.y, &outY[i], sizeof(float)) == 0
+            && memcmp(&rotated.z, &outZ[i], sizeof(float)) == 0;
+    }
+    printf("    quaternion rotation : scalar %.2f ms, kernel %.2f ms, x%.2f %s\n", scalarTime * 1000., kernelTime * 1000., scalarTime / kernelTime,
+        identical ? "" : "(DIFFERS FROM GLM)");
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+//benchmarks run from the "Benchmarks" tree of the debug window, results are printed on the standard output
+void benchmarkObjParsing();
+void benchmarkMeshCache();
+void benchmarkCulling();
+void benchmarkSceneBvh();
+void benchmarkMeshBvh();
+void benchmarkTransforms();
+void benchmarkTransformHierarchy();
+void benchmarkBatchMath();
@@ -0,0 +1,106 @@
+#include "camera.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace std;
+
+#define MAX_PITCH 1.55f     // just under 90 degrees, the view would flip past the poles
+
+camera::camera() :
+    speed(0.02f),
+    runningSpeedFactor(5.0),
+    fovY(glm::radians(60.f)),
+    ratio(16.f / 9.f),
+    nearPlane(0.0001f),
+    farPlane(100.f) {
+    this->reset();
+}
+
+void camera::reset() {
+    this->position = glm::vec3(0.f, 1.0f, 2.0f);
+    this->orientation = glm::quat(1.f, 0.f, 0.f, 0.f);
+    this->pitch = 0.f;
+    this->updateBasis();
+    this->projChanged = true;
+}
+
+void camera::rotate(float yaw, float pitch) {
+    float newPitch = max(-MAX_PITCH, min(MAX_PITCH, this->pitch + pitch));
+    pitch = newPitch - this->pitch;
+    this->pitch = newPitch;
+    if (yaw == 0.f && pitch == 0.f) {
+        return;
+    }
+    //world yaw on the left, local pitch on the right, renormalized so that the rounding errors do not add up
+    this->orientation = glm::normalize(glm::angleAxis(yaw, glm::vec3(0.f, 1.f, 0.f)) * this->orientation * glm::angleAxis(pitch, glm::vec3(1.f, 0.f, 0.f)));
+    this->updateBasis();
+}
+
+void camera::move(const glm::vec3& offset) {
+    this->position += offset;
+    this->viewChanged = true;
+}
+
+void camera::setPerspective(float fovY, float ratio, float nearPlane, float farPlane) {
+    if (fovY == this->fovY && ratio == this->ratio && nearPlane == this->nearPlane && farPlane == this->farPlane) {
+        return;
+    }
+    this->fovY = fovY;
+    this->ratio = ratio;
+    this->nearPlane = nearPlane;
+    this->farPlane = farPlane;
+    this->projChanged = true;
+}
+
+const glm::mat4& camera::getViewMatrix() {
+    this->updateMatrices();
+    return this->viewMatrix;
+}
+const glm::mat4& camera::getProjMatrix() {
+    this->updateMatrices();
+    return this->projMatrix;
+}
+const glm::mat4& camera::getViewProjMatrix() {
+    this->updateMatrices();
+    return this->viewProjMatrix;
+}
+const glm::mat4& camera::getInverseViewProjMatrix() {
+    this->updateMatrices();
+    return this->inverseViewProjMatrix;
+}
+
+void camera::updateBasis() {
+    //the columns of the rotation matrix are the camera axes in world space
+    glm::mat3 rotation = glm::mat3_cast(this->orientation);
+    this->relativeXAxis = rotation[0];
+    this->relativeYAxis = rotation[1];
+    this->relativeZAxis = -rotation[2];
+    this->viewChanged = true;
+}
+
+void camera::updateMatrices() {
+    if (!this->viewChanged && !this->projChanged) {
+        return;
+    }
+    if (this->viewChanged) {
+        //the view matrix is the transposed rotation followed by the opposite translation, no trigonometry or general inverse
+        glm::vec3 back = -this->relativeZAxis;
+        this->viewMatrix = glm::mat4(
+            this->relativeXAxis.x, this->relativeYAxis.x, back.x, 0.f,
+            this->relativeXAxis.y, this->relativeYAxis.y, back.y, 0.f,
+            this->relativeXAxis.z, this->relativeYAxis.z, back.z, 0.f,
+            -glm::dot(this->relativeXAxis, this->position), -glm::dot(this->relativeYAxis, this->position), -glm::dot(back, this->position), 1.f);
+        this->inverseViewMatrix = glm::mat4(glm::vec4(this->relativeXAxis, 0.f), glm::vec4(this->relativeYAxis, 0.f), glm::vec4(back, 0.f), glm::vec4(this->position, 1.f));
+        this->viewChanged = false;
+    }
+    if (this->projChanged) {
+        this->projMatrix = glm::perspective(this->fovY, this->ratio, this->nearPlane, this->farPlane);
+        this->inverseProjMatrix = glm::inverse(this->projMatrix);
+        this->projChanged = false;
+    }
+    this->viewProjMatrix = this->projMatrix * this->viewMatrix;
+    this->inverseViewProjMatrix = this->inverseViewMatrix * this->inverseProjMatrix;
+}
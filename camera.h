@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+//first person camera oriented by a quaternion, turned by small yaw and pitch steps
+//the basis vectors and the view matrix come straight from the quaternion, the matrices are only rebuilt when the camera
+//moved or its projection changed, one camera per viewport
+class camera {
+public:
+    glm::vec3 position;         // changed through move or reset so that the view matrix follows
+    glm::quat orientation;      // camera to world, looks along -Z with Y up at identity
+    float pitch;                // accumulated, kept to stop at the poles
+    glm::vec3 relativeXAxis;    // right, in world space
+    glm::vec3 relativeYAxis;    // up
+    glm::vec3 relativeZAxis;    // forward
+    float speed;
+    float runningSpeedFactor;
+
+    camera();
+    void reset();
+    //yaw around the world Y axis then pitch around the camera's own X axis, in radians
+    void rotate(float yaw, float pitch);
+    void move(const glm::vec3& offset);
+    //only marks the projection dirty when one of the values changed
+    void setPerspective(float fovY, float ratio, float nearPlane, float farPlane);
+    const glm::mat4& getViewMatrix();
+    const glm::mat4& getProjMatrix();
+    const glm::mat4& getViewProjMatrix();
+    //world from clip space, for the rays of picking
+    const glm::mat4& getInverseViewProjMatrix();
+
+private:
+    float fovY;
+    float ratio;
+    float nearPlane;
+    float farPlane;
+    bool viewChanged;
+    bool projChanged;
+    glm::mat4 viewMatrix;
+    glm::mat4 inverseViewMatrix;
+    glm::mat4 projMatrix;
+    glm::mat4 inverseProjMatrix;
+    glm::mat4 viewProjMatrix;
+    glm::mat4 inverseViewProjMatrix;
+
+    void updateBasis();
+    void updateMatrices();
+};
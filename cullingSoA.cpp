@@ -0,0 +1,130 @@
+#include "cullingSoA.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CULLING_X86
+#include <immintrin.h>
+#endif
+
+//tests spheres [begin, end) one at a time, used for the tail of the simd loops
+static unsigned int cullSpheresRange(frustum* viewFrustum, boundsSoA* bounds, unsigned int begin, unsigned int end, unsigned int* out) {
+    unsigned int count = 0;
+    for (unsigned int i = begin; i < end; i++) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++) {
+            glm::vec4 plane = viewFrustum->planes[p];
+            float distance = plane.x * bounds->centerX[i] + plane.y * bounds->centerY[i] + plane.z * bounds->centerZ[i] + plane.w;
+            inside = distance >= -bounds->radius[i];
+        }
+        out[count] = i;
+        count += inside;
+    }
+    return count;
+}
+
+unsigned int cullSpheresScalar(frustum* viewFrustum, boundsSoA* bounds, vector<unsigned int>* visibleIndices) {
+    visibleIndices->resize(bounds->size());
+    unsigned int count = cullSpheresRange(viewFrustum, bounds, 0, bounds->size(), visibleIndices->data());
+    visibleIndices->resize(count);
+    return count;
+}
+
+#ifdef CULLING_X86
+
+__attribute__((target("avx2")))
+static unsigned int cullSpheresAVX2(frustum* viewFrustum, boundsSoA* bounds, unsigned int* out) {
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; p++) {
+        planeX[p] = _mm256_set1_ps(viewFrustum->planes[p].x);
+        planeY[p] = _mm256_set1_ps(viewFrustum->planes[p].y);
+        planeZ[p] = _mm256_set1_ps(viewFrustum->planes[p].z);
+        planeW[p] = _mm256_set1_ps(viewFrustum->planes[p].w);
+    }
+    const float* centerX = bounds->centerX.data();
+    const float* centerY = bounds->centerY.data();
+    const float* centerZ = bounds->centerZ.data();
+    const float* radius = bounds->radius.data();
+    unsigned int size = bounds->size(), count = 0, i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256 x = _mm256_loadu_ps(centerX + i);
+        __m256 y = _mm256_loadu_ps(centerY + i);
+        __m256 z = _mm256_loadu_ps(centerZ + i);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            //same operation order as the scalar test so that both give the exact same result
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)), _mm256_mul_ps(planeZ[p], z)), planeW[p]);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+        //compact the visible lanes
+        unsigned int mask = _mm256_movemask_ps(inside);
+        while (mask) {
+            out[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    return count + cullSpheresRange(viewFrustum, bounds, i, size, out + count);
+}
+
+static unsigned int cullSpheresSSE(frustum* viewFrustum, boundsSoA* bounds, unsigned int* out) {
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; p++) {
+        planeX[p] = _mm_set1_ps(viewFrustum->planes[p].x);
+        planeY[p] = _mm_set1_ps(viewFrustum->planes[p].y);
+        planeZ[p] = _mm_set1_ps(viewFrustum->planes[p].z);
+        planeW[p] = _mm_set1_ps(viewFrustum->planes[p].w);
+    }
+    const float* centerX = bounds->centerX.data();
+    const float* centerY = bounds->centerY.data();
+    const float* centerZ = bounds->centerZ.data();
+    const float* radius = bounds->radius.data();
+    unsigned int size = bounds->size(), count = 0, i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128 x = _mm_loadu_ps(centerX + i);
+        __m128 y = _mm_loadu_ps(centerY + i);
+        __m128 z = _mm_loadu_ps(centerZ + i);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)), _mm_mul_ps(planeZ[p], z)), planeW[p]);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+        unsigned int mask = _mm_movemask_ps(inside);
+        while (mask) {
+            out[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    return count + cullSpheresRange(viewFrustum, bounds, i, size, out + count);
+}
+
+static bool hasAVX2() {
+    static bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+#endif
+
+unsigned int cullSpheres(frustum* viewFrustum, boundsSoA* bounds, vector<unsigned int>* visibleIndices) {
+    visibleIndices->resize(bounds->size());
+    unsigned int count;
+#ifdef CULLING_X86
+    if (hasAVX2()) {
+        count = cullSpheresAVX2(viewFrustum, bounds, visibleIndices->data());
+    }
+    else {
+        count = cullSpheresSSE(viewFrustum, bounds, visibleIndices->data());
+    }
+#else
+    count = cullSpheresRange(viewFrustum, bounds, 0, bounds->size(), visibleIndices->data());
+#endif
+    visibleIndices->resize(count);
+    return count;
+}
+
+const char* getCullingKernelName() {
+#ifdef CULLING_X86
+    return hasAVX2() ? "AVX2" : "SSE";
+#else
+    return "scalar";
+#endif
+}
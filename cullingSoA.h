@@ -0,0 +1,38 @@
+#pragma once
+
+#include "frustum.h"
+
+#include <vector>
+
+using namespace std;
+
+//bounding spheres of many items in structure of arrays form, so that the culling kernel can load 8 of them at once
+struct boundsSoA {
+    vector<float> centerX;
+    vector<float> centerY;
+    vector<float> centerZ;
+    vector<float> radius;
+    unsigned int size() {
+        return this->radius.size();
+    }
+    void resize(unsigned int count) {
+        this->centerX.resize(count);
+        this->centerY.resize(count);
+        this->centerZ.resize(count);
+        this->radius.resize(count);
+    }
+    void set(unsigned int i, const glm::vec3& center, float radius) {
+        this->centerX[i] = center.x;
+        this->centerY[i] = center.y;
+        this->centerZ[i] = center.z;
+        this->radius[i] = radius;
+    }
+}typedef boundsSoA;
+
+//writes the indices of the spheres intersecting the frustum in visibleIndices (in increasing order), returns their count
+//AVX2 (8 spheres per iteration) when the cpu has it, SSE (4) otherwise, scalar on other architectures
+unsigned int cullSpheres(frustum* viewFrustum, boundsSoA* bounds, vector<unsigned int>* visibleIndices);
+//same result, one sphere at a time
+unsigned int cullSpheresScalar(frustum* viewFrustum, boundsSoA* bounds, vector<unsigned int>* visibleIndices);
+//name of the kernel cullSpheres uses on this cpu
+const char* getCullingKernelName();
@@ -0,0 +1,67 @@
+#include "fileWatcher.h"
+
+#include <algorithm>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <limits.h>
+
+fileWatcher::fileWatcher() :
+    fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+}
+
+fileWatcher::~fileWatcher() {
+    if (this->fd >= 0) {
+        close(this->fd);
+    }
+}
+
+bool fileWatcher::watch(const char* fileName) {
+    if (this->fd < 0) {
+        return false;
+    }
+    string path = fileName;
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : path.substr(0, slash);
+    string baseName = slash == string::npos ? path : path.substr(slash + 1);
+    if (this->watchByDirectory.find(directory) == this->watchByDirectory.end()) {
+        int wd = inotify_add_watch(this->fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0) {
+            return false;
+        }
+        this->directories[wd] = directory;
+        this->watchByDirectory[directory] = wd;
+    }
+    this->watchedNames[directory + "/" + baseName] = path;
+    return true;
+}
+
+bool fileWatcher::poll(vector<string>* changedFiles) {
+    if (this->fd < 0) {
+        return false;
+    }
+    size_t firstChange = changedFiles->size();
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t length = read(this->fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + ((inotify_event*)p)->len) {
+            const inotify_event* event = (const inotify_event*)p;
+            auto directory = this->directories.find(event->wd);
+            if (event->len == 0 || directory == this->directories.end()) {
+                continue;
+            }
+            auto watched = this->watchedNames.find(directory->second + "/" + event->name);
+            if (watched == this->watchedNames.end()) {
+                continue;
+            }
+            //a save is often several events, the file is reported once
+            if (find(changedFiles->begin() + firstChange, changedFiles->end(), watched->second) == changedFiles->end()) {
+                changedFiles->push_back(watched->second);
+            }
+        }
+    }
+    return changedFiles->size() > firstChange;
+}
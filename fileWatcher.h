@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+//reports the watched files that were written or replaced, with inotify on their directories
+//(editors often save by renaming a new file over the old one, which a watch on the file itself would miss)
+class fileWatcher {
+public:
+    fileWatcher();
+    ~fileWatcher();
+    //owns the inotify descriptor closed by the destructor
+    fileWatcher(const fileWatcher&) = delete;
+    fileWatcher& operator=(const fileWatcher&) = delete;
+    //false if inotify is not available
+    bool watch(const char* fileName);
+    //never blocks, appends each changed file once (as given to watch) and returns true if there was one
+    bool poll(vector<string>* changedFiles);
+
+private:
+    int fd;
+    unordered_map<int, string> directories;                 // by watch descriptor
+    unordered_map<string, int> watchByDirectory;
+    unordered_map<string, string> watchedNames;             // directory + "/" + base name -> file name given to watch
+};
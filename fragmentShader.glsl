@@ -1,59 +1,62 @@
 #version 330 core
+//SHOW_NORMALS : the geometry stage also emits the normals, with hudLevel 2
+//EDGES : flat edge color instead of the lit texture
+//BACK_SIDE_EDGES : edges and normals are drawn over the faces
 
 in vec2 TexCoord;
-flat in int hudLevel;
-in vec3 baryCoord;
-in vec3 baryFactor;
 in vec3 normal;
+flat in vec4 edgesColor;
+#ifdef SHOW_NORMALS
+flat in int hudLevel;
+#endif
 
-uniform float time;
-uniform sampler2D numbersTexture;
+layout (std140) uniform frameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 camPos;
+    float ratio;
+    float time;
+    float normalSize;
+    int showNormals;
+    int showVertexIndices;
+    int showVertices;
+    int showBackSideEdges;
+};
 uniform sampler2D materialTexture;
-uniform int showBackSideEdges;
-uniform int showVertexIndices;
-uniform int isEdge;
-uniform vec4 edgesColor;
+
+//gl_FragDepth is only written by the permutations that need it, the others keep early depth testing
+#if defined(BACK_SIDE_EDGES) && (defined(EDGES) || defined(SHOW_NORMALS))
+#define WRITES_DEPTH
+#endif
+
 void main(){
 
+#ifdef WRITES_DEPTH
     gl_FragDepth = gl_FragCoord.z;
+#endif
 
-    if(hudLevel == 0){
-        if(isEdge == 1){
-            gl_FragColor = edgesColor*0.7;
-            if(showBackSideEdges == 1){
-                gl_FragDepth = 0.01;
-            }
-        }else{
-            vec3 lightPos = vec3(3.*cos(time),0.2,3.*sin(time));
-            vec3 lightDir = normalize(lightPos);
-            vec4 lightcolor = vec4(1.0);
-            float lightIntensity = .4;
-            vec4 objectColor;
-            if(true){
-                objectColor = texture(materialTexture,TexCoord);
-            }else{
-                objectColor = vec4(1., .8, .8, 0.0);
-            }
-            
-            float angularFactor = max(dot(normal,lightDir),0.);
-            gl_FragColor = 0.4*objectColor + lightcolor*lightIntensity*angularFactor;
-        
-        }
-    }
-    else if(hudLevel == 1){
-        if(showVertexIndices == 1){
-            gl_FragColor = texture(numbersTexture,TexCoord);
-        }else{
-            gl_FragColor = edgesColor*0.7;
-        }
-        if(showBackSideEdges == 1){
-            gl_FragDepth = 0.00;
-        }    
-    } else if(hudLevel == 2){
+#ifdef SHOW_NORMALS
+    if(hudLevel == 2){
         gl_FragColor = vec4(1.,1.,0.,0.);
-        if(showBackSideEdges == 1){
+#ifdef BACK_SIDE_EDGES
         gl_FragDepth = 0.01;
+#endif
+        return;
     }
-    }
-    
-} 
\ No newline at end of file
+#endif
+
+#ifdef EDGES
+    gl_FragColor = edgesColor*0.7;
+#ifdef BACK_SIDE_EDGES
+    gl_FragDepth = 0.01;
+#endif
+#else
+    vec3 lightPos = vec3(3.*cos(time),0.2,3.*sin(time));
+    vec3 lightDir = normalize(lightPos);
+    vec4 lightcolor = vec4(1.0);
+    float lightIntensity = .4;
+    vec4 objectColor = texture(materialTexture,TexCoord);
+    float angularFactor = max(dot(normalize(normal),lightDir),0.);
+    gl_FragColor = 0.4*objectColor + lightcolor*lightIntensity*angularFactor;
+#endif
+}
@@ -0,0 +1,61 @@
+#include "frustum.h"
+
+#include <cmath>
+
+void frustum::extract(const glm::mat4& m) {
+    //rows of the matrix (glm is column major)
+    glm::vec4 row0 = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1 = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2 = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3 = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+    this->planes[0] = row3 + row0;
+    this->planes[1] = row3 - row0;
+    this->planes[2] = row3 + row1;
+    this->planes[3] = row3 - row1;
+    this->planes[4] = row3 + row2;
+    this->planes[5] = row3 - row2;
+    //normalized so that plane distances are real distances (needed by the sphere test)
+    for (int i = 0; i < 6; i++) {
+        glm::vec4 p = this->planes[i];
+        float length = sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+        this->planes[i] = p / length;
+    }
+}
+
+bool frustum::intersectsSphere(const glm::vec3& center, float radius) {
+    for (int i = 0; i < 6; i++) {
+        glm::vec4 p = this->planes[i];
+        if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool frustum::intersectsBox(const glm::vec3& center, const glm::vec3& halfExtents) {
+    for (int i = 0; i < 6; i++) {
+        glm::vec4 p = this->planes[i];
+        //projected radius of the box on the plane normal
+        float radius = halfExtents.x * fabs(p.x) + halfExtents.y * fabs(p.y) + halfExtents.z * fabs(p.z);
+        if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int frustum::classifyBox(const glm::vec3& center, const glm::vec3& halfExtents) {
+    int result = FRUSTUM_INSIDE;
+    for (int i = 0; i < 6; i++) {
+        glm::vec4 p = this->planes[i];
+        float radius = halfExtents.x * fabs(p.x) + halfExtents.y * fabs(p.y) + halfExtents.z * fabs(p.z);
+        float distance = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+        if (distance < -radius) {
+            return FRUSTUM_OUTSIDE;
+        }
+        if (distance < radius) {
+            result = FRUSTUM_INTERSECTS;
+        }
+    }
+    return result;
+}
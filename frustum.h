@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#define FRUSTUM_OUTSIDE 0
+#define FRUSTUM_INTERSECTS 1
+#define FRUSTUM_INSIDE 2
+
+//the six planes of a view frustum, normals pointing inside (ax + by + cz + d >= 0 inside)
+struct frustum {
+    glm::vec4 planes[6];    // left, right, bottom, top, near, far
+    //planes of projMatrix * viewMatrix, in world space
+    void extract(const glm::mat4& viewProjMatrix);
+    bool intersectsSphere(const glm::vec3& center, float radius);
+    bool intersectsBox(const glm::vec3& center, const glm::vec3& halfExtents);
+    //FRUSTUM_OUTSIDE, FRUSTUM_INTERSECTS or FRUSTUM_INSIDE (the whole box is inside)
+    int classifyBox(const glm::vec3& center, const glm::vec3& halfExtents);
+}typedef frustum;
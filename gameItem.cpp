@@ -1,9 +1,132 @@
 #include "gameItem.h"
-void gameItem::loadMeshFromObjFile(char* filename){
+#include "objLoader.h"
+#include "textureCache.h"
 
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+void gameItem::getWorldBounds(const glm::mat4& modelMatrix, glm::vec3* center, float* radius, glm::vec3* halfExtents) {
+    glm::vec4 worldCenter = modelMatrix * glm::vec4(this->boundsCenter, 1.f);
+    *center = glm::vec3(worldCenter.x, worldCenter.y, worldCenter.z);
+    //the sphere grows with the biggest scale of the matrix
+    float maxScale2 = 0.f;
+    for (int i = 0; i < 3; i++) {
+        glm::vec3 axis = glm::vec3(modelMatrix[i].x, modelMatrix[i].y, modelMatrix[i].z);
+        maxScale2 = max(maxScale2, glm::dot(axis, axis));
+    }
+    *radius = this->boundsRadius * sqrt(maxScale2);
+    //box of the rotated box : |M| * extents
+    glm::vec3 extents = 0.5f * (this->boundsMax - this->boundsMin);
+    for (int i = 0; i < 3; i++) {
+        (*halfExtents)[i] = fabs(modelMatrix[0][i]) * extents.x + fabs(modelMatrix[1][i]) * extents.y + fabs(modelMatrix[2][i]) * extents.z;
+    }
+}
+
+void gameItem::loadMeshFromObjFile(const char* fileName) {
+    auto start = chrono::steady_clock::now();
+    meshCacheMapping cache;
+    bool cached = openMeshCache(fileName, &cache);
+    if (cached && (cache.normalCount != cache.vertexCount / VERTEX_SIZE * NORMAL_SIZE || cache.splitSourceCount > cache.vertexCount / VERTEX_SIZE)) {
+        closeMeshCache(&cache);
+        cached = false;
+    }
+    if (cached) {
+        //uploaded straight from the mapping, which stays alive with the item for its CPU side users (bvh, indirect renderer)
+        this->meshMapping = cache;
+        gameItem::loadMesh(cache.vertices, cache.vertexCount, cache.indices, cache.indexCount, cache.normals,
+            cache.vertexCount / VERTEX_SIZE - cache.splitSourceCount, cache.splitSources);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        std::cout << "Loaded " << fileName << " from cache : " << this->indexCount / 3 << " triangles in " << seconds * 1000. << " ms" << std::endl;
+        return;
+    }
+
+    objData data;
+    bool loaded = loadObjFileParallel(fileName, &data);
+    if (!loaded) {
+        std::cout << "Failed to load obj file : " << fileName << std::endl;
+    }
+    vector<float> meshVertices;
+    vector<unsigned int> meshIndices;
+    vector<float> meshNormals;
+    vector<unsigned int> meshSplitSources;
+    meshWeldStats weldStats;
+    buildInterleavedMesh(&data, &meshVertices, &meshIndices, &weldStats, &meshNormals, &meshSplitSources);
+    if (meshNormals.empty()) {
+        gameItem::computeVertexNormals(&meshVertices, &meshIndices, &meshNormals, &meshSplitSources);
+    }
+    unsigned int uniqueVertexCount = meshVertices.size() / VERTEX_SIZE - meshSplitSources.size();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    //the item keeps its mesh data, like the hand written meshes of main.cpp
+    this->vertexCount = meshVertices.size();
+    this->vertices = new float[this->vertexCount];
+    copy(meshVertices.begin(), meshVertices.end(), this->vertices);
+    this->indexCount = meshIndices.size();
+    this->indices = new unsigned int[this->indexCount];
+    copy(meshIndices.begin(), meshIndices.end(), this->indices);
+    float* normals = new float[meshNormals.size()];
+    copy(meshNormals.begin(), meshNormals.end(), normals);
+    unsigned int* splitSources = new unsigned int[meshSplitSources.size()];
+    copy(meshSplitSources.begin(), meshSplitSources.end(), splitSources);
+
+    std::cout << "Loaded " << fileName << " : " << data.getTriangleCount() << " triangles in " << seconds * 1000. << " ms" << std::endl;
+    std::cout << "    welded " << weldStats.cornerCount << " corners into " << weldStats.vertexCount << " vertices (x" << weldStats.getDedupRatio()
+        << ", " << (weldStats.cornerCount - weldStats.vertexCount) * VERTEX_SIZE * sizeof(float) / 1024 << " KB of VBO saved) in " << weldStats.seconds * 1000. << " ms" << std::endl;
+    if (loaded && !writeMeshCache(fileName, this->vertices, this->vertexCount, this->indices, this->indexCount, meshNormals.data(), meshNormals.size(),
+        meshSplitSources.data(), meshSplitSources.size())) {
+        std::cout << "Failed to write mesh cache of " << fileName << std::endl;
+    }
+    gameItem::loadMesh(this->vertices, this->vertexCount, this->indices, this->indexCount, normals, uniqueVertexCount, splitSources);
 }
 
-void gameItem::loadMesh(float* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount) {
+void gameItem::loadMesh(float* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount, float* normals,
+    unsigned int uniqueVertexCount, unsigned int* splitSources) {
+    if (normals) {
+        this->normals = normals;
+        this->uniqueVertexCount = uniqueVertexCount == 0 || !splitSources ? vertexCount / VERTEX_SIZE : uniqueVertexCount;
+        this->splitSources = splitSources;
+    }
+    else {
+        vector<float> meshVertices(vertices, vertices + vertexCount);
+        vector<unsigned int> meshIndices(indices, indices + indexCount);
+        vector<float> meshNormals;
+        vector<unsigned int> meshSplitSources;
+        this->uniqueVertexCount = vertexCount / VERTEX_SIZE;
+        gameItem::computeVertexNormals(&meshVertices, &meshIndices, &meshNormals, &meshSplitSources);
+        this->splitSources = new unsigned int[meshSplitSources.size()];
+        copy(meshSplitSources.begin(), meshSplitSources.end(), this->splitSources);
+        //vertices on hard edges were split, the item gets its own arrays (the given ones belong to the caller)
+        if (meshVertices.size() != vertexCount) {
+            vertexCount = meshVertices.size();
+            vertices = new float[vertexCount];
+            copy(meshVertices.begin(), meshVertices.end(), vertices);
+            indices = new unsigned int[indexCount];
+            copy(meshIndices.begin(), meshIndices.end(), indices);
+        }
+        this->normals = new float[meshNormals.size()];
+        copy(meshNormals.begin(), meshNormals.end(), this->normals);
+    }
+    this->vertices = vertices;
+    this->vertexCount = vertexCount;
+    this->indices = indices;
+    this->indexCount = indexCount;
+
+    this->boundsMin = glm::vec3(0.f);
+    this->boundsMax = glm::vec3(0.f);
+    for (unsigned int i = 0; i + 2 < vertexCount; i += VERTEX_SIZE) {
+        glm::vec3 p = glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]);
+        this->boundsMin = i == 0 ? p : glm::min(this->boundsMin, p);
+        this->boundsMax = i == 0 ? p : glm::max(this->boundsMax, p);
+    }
+    this->boundsCenter = 0.5f * (this->boundsMin + this->boundsMax);
+    this->boundsRadius = 0.f;
+    for (unsigned int i = 0; i + 2 < vertexCount; i += VERTEX_SIZE) {
+        glm::vec3 d = glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]) - this->boundsCenter;
+        this->boundsRadius = max(this->boundsRadius, glm::dot(d, d));
+    }
+    this->boundsRadius = sqrt(this->boundsRadius);
+
     glGenVertexArrays(1, &this->VAO);
     glBindVertexArray(this->VAO);
 
@@ -17,39 +140,115 @@ void gameItem::loadMesh(float* vertices, unsigned int vertexCount, unsigned int*
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(int), indices, GL_STATIC_DRAW);
 
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VERTEX_SIZE * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, VERTEX_SIZE * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
+
+    //locations 2 to 6 and 8 to 10 are the per instance attributes
+    glGenBuffers(1, &this->normalVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->normalVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount / VERTEX_SIZE * NORMAL_SIZE * sizeof(float), this->normals, GL_STATIC_DRAW);
+    glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, NORMAL_SIZE * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(7);
 }
-unsigned int gameItem::loadTexture(const char* fileName) {
-    unsigned int texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);// or GL_LINEAR
-
-    string fullFileName = "./textures/";
-    fullFileName += fileName;
-    int texWidth, texHeight, nrChannels;
-    unsigned char* data = stbi_load(fullFileName.c_str(), &texWidth, &texHeight, &nrChannels, 0);
-    unsigned int sourcePixelFormat = GL_RGB;
-    if (nrChannels == 4) {
-        sourcePixelFormat = GL_RGBA;
-    }
-    if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texWidth, texHeight, 0, sourcePixelFormat, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+void gameItem::destroyMesh() {
+    glDeleteBuffers(1, &this->EBO);
+    glDeleteBuffers(1, &this->VBO);
+    glDeleteBuffers(1, &this->normalVBO);
+    glDeleteVertexArrays(1, &this->VAO);
+    closeMeshCache(&this->meshMapping);
+}
+unsigned int gameItem::getSourceVertex(unsigned int vertex) {
+    return vertex < this->uniqueVertexCount ? vertex : this->splitSources[vertex - this->uniqueVertexCount];
+}
+void gameItem::computeVertexNormals(vector<float>* vertices, vector<unsigned int>* indices, vector<float>* normals, vector<unsigned int>* splitSources) {
+    unsigned int vertexCount = vertices->size() / VERTEX_SIZE;
+    unsigned int cornerCount = indices->size() / 3 * 3;
+    //not normalized, their length is twice the area of the face, the directions are only used to find the hard edges
+    vector<glm::vec3> faceNormals(cornerCount / 3);
+    vector<glm::vec3> faceDirections(cornerCount / 3);
+    for (unsigned int t = 0; t < cornerCount / 3; t++) {
+        const float* a = vertices->data() + (size_t)(*indices)[3 * t] * VERTEX_SIZE;
+        const float* b = vertices->data() + (size_t)(*indices)[3 * t + 1] * VERTEX_SIZE;
+        const float* c = vertices->data() + (size_t)(*indices)[3 * t + 2] * VERTEX_SIZE;
+        faceNormals[t] = glm::cross(glm::vec3(b[0] - a[0], b[1] - a[1], b[2] - a[2]), glm::vec3(c[0] - a[0], c[1] - a[1], c[2] - a[2]));
+        float length = glm::length(faceNormals[t]);
+        faceDirections[t] = length > 0.f ? faceNormals[t] / length : glm::vec3(0.f);
     }
-    else {
-        std::cout << "Failed to load texture : " << fileName << std::endl;
+    //faces around each vertex, in compressed rows
+    vector<unsigned int> faceOffsets(vertexCount + 1, 0);
+    for (unsigned int i = 0; i < cornerCount; i++) {
+        faceOffsets[(*indices)[i] + 1]++;
+    }
+    for (unsigned int i = 0; i < vertexCount; i++) {
+        faceOffsets[i + 1] += faceOffsets[i];
+    }
+    vector<unsigned int> vertexFaces(cornerCount);
+    vector<unsigned int> cursors(faceOffsets.begin(), faceOffsets.end() - 1);
+    for (unsigned int i = 0; i < cornerCount; i++) {
+        vertexFaces[cursors[(*indices)[i]]++] = i / 3;
+    }
+
+    //each corner only averages the faces of its vertex on the same side of the hard edges as its own face
+    //a vertex gets one copy per distinct normal of its corners, the first one keeps its index
+    normals->assign((size_t)vertexCount * NORMAL_SIZE, 0.f);
+    if (splitSources) {
+        splitSources->clear();
+    }
+    const unsigned int noCopy = 0xFFFFFFFFu;
+    vector<bool> assigned(vertexCount, false);
+    vector<unsigned int> nextCopies(vertexCount, noCopy);
+    for (unsigned int i = 0; i < cornerCount; i++) {
+        unsigned int vertex = (*indices)[i];
+        glm::vec3 faceDirection = faceDirections[i / 3];
+        glm::vec3 n = glm::vec3(0.f);
+        for (unsigned int f = faceOffsets[vertex]; f < faceOffsets[vertex + 1]; f++) {
+            if (glm::dot(faceDirection, faceDirections[vertexFaces[f]]) >= HARD_EDGE_COS) {
+                n += faceNormals[vertexFaces[f]];
+            }
+        }
+        float length = glm::length(n);
+        if (length > 0.f) {
+            n /= length;
+        }
+        if (!assigned[vertex]) {
+            assigned[vertex] = true;
+            (*normals)[(size_t)vertex * NORMAL_SIZE] = n.x;
+            (*normals)[(size_t)vertex * NORMAL_SIZE + 1] = n.y;
+            (*normals)[(size_t)vertex * NORMAL_SIZE + 2] = n.z;
+            continue;
+        }
+        unsigned int copyIndex = vertex;
+        unsigned int lastCopy = vertex;
+        for (; copyIndex != noCopy; copyIndex = nextCopies[copyIndex]) {
+            const float* copyNormal = normals->data() + (size_t)copyIndex * NORMAL_SIZE;
+            if (copyNormal[0] == n.x && copyNormal[1] == n.y && copyNormal[2] == n.z) break;
+            lastCopy = copyIndex;
+        }
+        if (copyIndex == noCopy) {
+            copyIndex = vertices->size() / VERTEX_SIZE;
+            float copiedVertex[VERTEX_SIZE];
+            copy(vertices->begin() + (size_t)vertex * VERTEX_SIZE, vertices->begin() + (size_t)(vertex + 1) * VERTEX_SIZE, copiedVertex);
+            vertices->insert(vertices->end(), copiedVertex, copiedVertex + VERTEX_SIZE);
+            normals->push_back(n.x);
+            normals->push_back(n.y);
+            normals->push_back(n.z);
+            nextCopies.push_back(noCopy);
+            nextCopies[lastCopy] = copyIndex;
+            if (splitSources) splitSources->push_back(vertex);
+        }
+        (*indices)[i] = copyIndex;
     }
-    stbi_image_free(data);
-    return texture;
+}
+unsigned int gameItem::loadTexture(const char* fileName) {
+    return textureCache::get()->acquire(fileName);
+}
+void gameItem::retainTexture(unsigned int texture) {
+    textureCache::get()->retain(texture);
+}
+void gameItem::releaseTexture(unsigned int texture) {
+    textureCache::get()->release(texture);
 }
 gameItem::gameItem(const char* name, float* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount, const char* textureFileName) :
     name(name),
@@ -57,12 +256,17 @@ gameItem::gameItem(const char* name, float* vertices, unsigned int vertexCount,
     indexCount(indexCount),
     vertices(vertices),
     vertexCount(vertexCount),
-    position(glm::vec3(0)),
-    scale(glm::vec3(1.)),
-    rotationAxis(Y),
-    rotationAngle(0.),
+    transform(INVALID_TRANSFORM),
     edgesColor(glm::vec4(1.,0.,1.,1.)) {
 
     gameItem::loadMesh(vertices, vertexCount, indices, indexCount);
     this->texture = gameItem::loadTexture(textureFileName);
 }
+gameItem::gameItem(const char* name, const char* objFileName, const char* textureFileName) :
+    name(name),
+    transform(INVALID_TRANSFORM),
+    edgesColor(glm::vec4(1.,0.,1.,1.)) {
+
+    gameItem::loadMeshFromObjFile(objFileName);
+    this->texture = gameItem::loadTexture(textureFileName);
+}
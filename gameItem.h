@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 
 #include <cmath>
 #include <glm/glm.hpp>
@@ -10,6 +11,8 @@
 
 #include "glad/glad.h"
 #include "stb_image.h"
+#include "transformStore.h"
+#include "meshCache.h"
 
 #define X glm::vec3(1.f,.0f,.0f)
 #define Y glm::vec3(0.f,1.f,.0f)
@@ -18,6 +21,10 @@
 #define Y1 glm::vec4(0.f,1.f,.0f,1.0f)
 #define Z1 glm::vec4(0.f,.0f,1.0f,1.0f)
 
+#define VERTEX_SIZE 5   // floats per vertex : x y z u v
+#define NORMAL_SIZE 3   // floats per vertex normal : x y z, kept in their own buffer
+#define HARD_EDGE_COS 0.5f  // faces more than 60 degrees apart do not share their vertex normals
+
 using namespace std;
 
 class gameItem {
@@ -27,19 +34,46 @@ public:
     unsigned int indexCount;
     float* vertices;
     unsigned int vertexCount;
+    float* normals;             // one per vertex, from the obj file or computed by loadMesh
+    //vertices split at hard edges are copies appended after the first uniqueVertexCount, which keep the numbering of the
+    //mesh for the vertex markers and the picking, splitSources gives the vertex each copy comes from
+    unsigned int uniqueVertexCount;
+    unsigned int* splitSources;
+    meshCacheMapping meshMapping;   // when loaded from the mesh cache, the arrays above point into it
     unsigned int texture;
-    glm::vec3 position;
-    glm::vec3 scale;
-    glm::vec3 rotationAxis;
-    float rotationAngle;
+    transformHandle transform;  // position, scale and rotation, kept in the transformStore of the scene
     unsigned int VAO;
     unsigned int VBO;
     unsigned int EBO;
+    unsigned int normalVBO;
     glm::vec4 edgesColor;
-    void loadMeshFromObjFile(char* filename);
-    void loadMesh(float* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount);
+    //bounds of the mesh in model space, computed by loadMesh
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+    //world space bounding sphere and box (center, half extents) once transformed by modelMatrix
+    void getWorldBounds(const glm::mat4& modelMatrix, glm::vec3* center, float* radius, glm::vec3* halfExtents);
+    void loadMeshFromObjFile(const char* fileName);
+    //without normals they are computed, which may split vertices, the item then owns copies of the arrays
+    //with normals, the vertices from uniqueVertexCount on are split copies of splitSources (no copies when it is 0)
+    //the arrays are kept as given, they must live as long as the item
+    void loadMesh(float* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount, float* normals = NULL,
+        unsigned int uniqueVertexCount = 0, unsigned int* splitSources = NULL);
+    //deletes the buffers and unmaps the mesh cache, the copies of an item share them and are not destroyed on their own
+    void destroyMesh();
+    //the vertex of the mesh a vertex of the VBO was split from, itself when it is not a copy
+    unsigned int getSourceVertex(unsigned int vertex);
+    //area weighted average of the normals of the faces around each vertex, faces across a hard edge are left out
+    //a vertex on a hard edge is split in one copy per side (appended to vertices, indices rewritten) so a cube stays flat
+    //splitSources receives the vertex each copy comes from
+    static void computeVertexNormals(vector<float>* vertices, vector<unsigned int>* indices, vector<float>* normals,
+        vector<unsigned int>* splitSources = NULL);
     static unsigned int loadTexture(const char* fileName);
+    static void retainTexture(unsigned int texture);
+    static void releaseTexture(unsigned int texture);
     gameItem(const char* name, float* vertices, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount, const char* textureFileName);
+    gameItem(const char* name, const char* objFileName, const char* textureFileName);
 
 
 };
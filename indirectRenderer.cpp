@@ -0,0 +1,190 @@
+#include "indirectRenderer.h"
+
+#include <algorithm>
+
+//copies the used part of a buffer into a new one at least twice as big
+static void growBuffer(unsigned int* buffer, size_t* capacityBytes, size_t usedBytes, size_t neededBytes) {
+    size_t capacity = max<size_t>(*capacityBytes * 2, 1 << 20);
+    while (capacity < neededBytes) capacity *= 2;
+    unsigned int newBuffer;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STATIC_DRAW);
+    if (*buffer != 0) {
+        if (usedBytes > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, *buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+        }
+        glDeleteBuffers(1, buffer);
+    }
+    *buffer = newBuffer;
+    *capacityBytes = capacity;
+}
+
+indirectRenderer::indirectRenderer() :
+    useMultiDraw(true),
+    drawCallCount(0),
+    VAO(0),
+    vertexBuffer(0),
+    normalBuffer(0),
+    indexBuffer(0),
+    commandBuffer(0),
+    instanceBuffer(0),
+    vertexCapacity(0),
+    vertexUsed(0),
+    normalCapacity(0),
+    indexCapacity(0),
+    indexUsed(0) {}
+
+void indirectRenderer::create() {
+    glGenVertexArrays(1, &this->VAO);
+    glGenBuffers(1, &this->commandBuffer);
+}
+
+void indirectRenderer::destroy() {
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->vertexBuffer);
+    glDeleteBuffers(1, &this->normalBuffer);
+    glDeleteBuffers(1, &this->indexBuffer);
+    glDeleteBuffers(1, &this->commandBuffer);
+    this->VAO = this->vertexBuffer = this->normalBuffer = this->indexBuffer = this->commandBuffer = 0;
+    this->meshes.clear();
+    this->vertexCapacity = this->vertexUsed = this->normalCapacity = this->indexCapacity = this->indexUsed = 0;
+}
+
+bool indirectRenderer::supportsMultiDraw() {
+    return GLAD_GL_VERSION_4_3;
+}
+
+const arenaMesh* indirectRenderer::addMesh(gameItem* item) {
+    size_t vertexFloatCount = item->vertexCount;
+    if (this->vertexUsed + vertexFloatCount > this->vertexCapacity) {
+        size_t capacityBytes = this->vertexCapacity * sizeof(float);
+        growBuffer(&this->vertexBuffer, &capacityBytes, this->vertexUsed * sizeof(float), (this->vertexUsed + vertexFloatCount) * sizeof(float));
+        this->vertexCapacity = capacityBytes / sizeof(float);
+        //the VAO has to point at the new vertex buffer
+        glBindVertexArray(this->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VERTEX_SIZE * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, VERTEX_SIZE * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+    size_t normalUsed = this->vertexUsed / VERTEX_SIZE * NORMAL_SIZE;
+    size_t normalFloatCount = vertexFloatCount / VERTEX_SIZE * NORMAL_SIZE;
+    if (normalUsed + normalFloatCount > this->normalCapacity) {
+        size_t capacityBytes = this->normalCapacity * sizeof(float);
+        growBuffer(&this->normalBuffer, &capacityBytes, normalUsed * sizeof(float), (normalUsed + normalFloatCount) * sizeof(float));
+        this->normalCapacity = capacityBytes / sizeof(float);
+        glBindVertexArray(this->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, this->normalBuffer);
+        glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, NORMAL_SIZE * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(7);
+    }
+    if (this->indexUsed + item->indexCount > this->indexCapacity) {
+        size_t capacityBytes = this->indexCapacity * sizeof(unsigned int);
+        growBuffer(&this->indexBuffer, &capacityBytes, this->indexUsed * sizeof(unsigned int), (this->indexUsed + item->indexCount) * sizeof(unsigned int));
+        this->indexCapacity = capacityBytes / sizeof(unsigned int);
+        glBindVertexArray(this->VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+    }
+
+    arenaMesh mesh;
+    mesh.baseVertex = this->vertexUsed / VERTEX_SIZE;
+    mesh.firstIndex = this->indexUsed;
+    mesh.indexCount = item->indexCount;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, this->vertexUsed * sizeof(float), vertexFloatCount * sizeof(float), item->vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->normalBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, normalUsed * sizeof(float), normalFloatCount * sizeof(float), item->normals);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, this->indexUsed * sizeof(unsigned int), item->indexCount * sizeof(unsigned int), item->indices);
+    this->vertexUsed += vertexFloatCount;
+    this->indexUsed += item->indexCount;
+    return &(this->meshes[item->VAO] = mesh);
+}
+
+void indirectRenderer::setInstanceAttributes(unsigned int firstInstance) {
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer);
+    size_t offset = firstInstance * sizeof(instanceData);
+    for (int column = 0; column < 4; column++) {
+        glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(instanceData), (void*)(offset + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(2 + column, 1);
+        glEnableVertexAttribArray(2 + column);
+    }
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(instanceData), (void*)(offset + sizeof(glm::mat4)));
+    glVertexAttribDivisor(6, 1);
+    glEnableVertexAttribArray(6);
+    for (int column = 0; column < 3; column++) {
+        glVertexAttribPointer(8 + column, 3, GL_FLOAT, GL_FALSE, sizeof(instanceData), (void*)(offset + offsetof(instanceData, normalMatrix) + column * sizeof(glm::vec3)));
+        glVertexAttribDivisor(8 + column, 1);
+        glEnableVertexAttribArray(8 + column);
+    }
+}
+
+void indirectRenderer::prepare(vector<gameItem>* items, const vector<unsigned int>* visibleItems, const vector<glm::mat4>* modelMatrices,
+    const vector<glm::mat3>* normalMatrices, instancedRenderer* instancing, bool itemsChanged) {
+    instancing->prepare(items, visibleItems, modelMatrices, normalMatrices, itemsChanged);
+    this->instanceBuffer = instancing->getInstanceBuffer();
+
+    //batches sorted by texture so each texture is one multi draw
+    vector<const instanceBatch*> batches;
+    batches.reserve(instancing->batches.size());
+    for (const instanceBatch& batch : instancing->batches) {
+        batches.push_back(&batch);
+    }
+    sort(batches.begin(), batches.end(), [](const instanceBatch* a, const instanceBatch* b) { return a->texture < b->texture; });
+
+    this->commands.clear();
+    this->groups.clear();
+    for (const instanceBatch* batch : batches) {
+        auto found = this->meshes.find(batch->VAO);
+        const arenaMesh* mesh = found != this->meshes.end() ? &found->second : this->addMesh(&(*items)[batch->firstItem]);
+        drawElementsIndirectCommand command;
+        command.count = mesh->indexCount;
+        command.instanceCount = batch->instanceCount;
+        command.firstIndex = mesh->firstIndex;
+        command.baseVertex = mesh->baseVertex;
+        command.baseInstance = batch->firstInstance;
+        if (this->groups.empty() || this->groups.back().texture != batch->texture) {
+            commandGroup group;
+            group.texture = batch->texture;
+            group.firstCommand = this->commands.size();
+            group.commandCount = 0;
+            this->groups.push_back(group);
+        }
+        this->groups.back().commandCount++;
+        this->commands.push_back(command);
+    }
+
+    if (this->useMultiDraw && this->supportsMultiDraw()) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, this->commands.size() * sizeof(drawElementsIndirectCommand), this->commands.data(), GL_STREAM_DRAW);
+    }
+}
+
+void indirectRenderer::draw(bool bindTextures) {
+    this->drawCallCount = 0;
+    glBindVertexArray(this->VAO);
+    if (this->useMultiDraw && this->supportsMultiDraw()) {
+        //baseInstance selects each command's slice of the instance buffer
+        this->setInstanceAttributes(0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->commandBuffer);
+        for (commandGroup& group : this->groups) {
+            if (bindTextures) glBindTexture(GL_TEXTURE_2D, group.texture);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(group.firstCommand * sizeof(drawElementsIndirectCommand)), group.commandCount, 0);
+            this->drawCallCount++;
+        }
+        return;
+    }
+    //no base instance before GL 4.2 : the instance attributes are moved for each command instead
+    for (commandGroup& group : this->groups) {
+        if (bindTextures) glBindTexture(GL_TEXTURE_2D, group.texture);
+        for (unsigned int i = group.firstCommand; i < group.firstCommand + group.commandCount; i++) {
+            drawElementsIndirectCommand* command = &this->commands[i];
+            this->setInstanceAttributes(command->baseInstance);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command->count, GL_UNSIGNED_INT, (void*)(command->firstIndex * sizeof(unsigned int)), command->instanceCount, command->baseVertex);
+            this->drawCallCount++;
+        }
+    }
+}
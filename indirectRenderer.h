@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "glad/glad.h"
+
+#include "gameItem.h"
+#include "instancedRenderer.h"
+
+using namespace std;
+
+//layout read by glMultiDrawElementsIndirect
+struct drawElementsIndirectCommand {
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
+}typedef drawElementsIndirectCommand;
+
+//where a mesh lives in the shared buffers
+struct arenaMesh {
+    int baseVertex;
+    unsigned int firstIndex;
+    unsigned int indexCount;
+}typedef arenaMesh;
+
+//commands that can be submitted together (same texture)
+struct commandGroup {
+    unsigned int texture;
+    unsigned int firstCommand;
+    unsigned int commandCount;
+}typedef commandGroup;
+
+//all the meshes suballocated in one vertex buffer and one index buffer behind a single VAO,
+//the scene is submitted with one glMultiDrawElementsIndirect per texture (a CPU loop before GL 4.3)
+class indirectRenderer {
+public:
+    bool useMultiDraw;          // false forces the CPU loop
+    unsigned int drawCallCount; // GL draw calls of the last draw()
+    vector<commandGroup> groups;
+
+    indirectRenderer();
+    void create();
+    void destroy();
+    bool supportsMultiDraw();
+    //one command per instanced batch, the instance data is the one uploaded by instancing.prepare
+    void prepare(vector<gameItem>* items, const vector<unsigned int>* visibleItems, const vector<glm::mat4>* modelMatrices,
+        const vector<glm::mat3>* normalMatrices, instancedRenderer* instancing, bool itemsChanged);
+    void draw(bool bindTextures);
+    unsigned int getMeshCount() {
+        return this->meshes.size();
+    }
+
+private:
+    unsigned int VAO;
+    unsigned int vertexBuffer;
+    unsigned int normalBuffer;  // NORMAL_SIZE floats for each vertex of vertexBuffer
+    unsigned int indexBuffer;
+    unsigned int commandBuffer;
+    unsigned int instanceBuffer;
+    size_t vertexCapacity;  // in floats
+    size_t vertexUsed;
+    size_t normalCapacity;  // in floats
+    size_t indexCapacity;   // in indices
+    size_t indexUsed;
+    unordered_map<unsigned int, arenaMesh> meshes;  // by the VAO of the mesh's own buffers
+    vector<drawElementsIndirectCommand> commands;
+
+    const arenaMesh* addMesh(gameItem* item);
+    void setInstanceAttributes(unsigned int firstInstance);
+};
@@ -0,0 +1,94 @@
+#include "instancedRenderer.h"
+
+void instancedRenderer::create() {
+    glGenBuffers(1, &this->instanceBuffer);
+}
+
+void instancedRenderer::destroy() {
+    glDeleteBuffers(1, &this->instanceBuffer);
+    this->instanceBuffer = 0;
+}
+
+void instancedRenderer::prepare(vector<gameItem>* items, const vector<unsigned int>* visibleItems, const vector<glm::mat4>* modelMatrices,
+    const vector<glm::mat3>* normalMatrices, bool itemsChanged) {
+    this->reusedInstances = !itemsChanged && *visibleItems == this->preparedItems;
+    if (this->reusedInstances) {
+        return;
+    }
+    this->preparedItems = *visibleItems;
+    //count the instances of each batch, then write every item at its batch's offset
+    this->batches.clear();
+    this->batchByKey.clear();
+    size_t visibleCount = visibleItems->size();
+    this->itemBatches.resize(visibleCount);
+    for (size_t v = 0; v < visibleCount; v++) {
+        unsigned int i = (*visibleItems)[v];
+        gameItem* item = &(*items)[i];
+        uint64_t key = (uint64_t)item->VAO << 32 | item->texture;
+        auto found = this->batchByKey.find(key);
+        if (found == this->batchByKey.end()) {
+            instanceBatch batch;
+            batch.VAO = item->VAO;
+            batch.texture = item->texture;
+            batch.indexCount = item->indexCount;
+            batch.vertexCount = item->uniqueVertexCount;
+            batch.firstItem = i;
+            batch.firstInstance = 0;
+            batch.instanceCount = 0;
+            found = this->batchByKey.insert(make_pair(key, (unsigned int)this->batches.size())).first;
+            this->batches.push_back(batch);
+        }
+        this->batches[found->second].instanceCount++;
+        this->itemBatches[v] = found->second;
+    }
+    unsigned int instanceCount = 0;
+    for (instanceBatch& batch : this->batches) {
+        batch.firstInstance = instanceCount;
+        instanceCount += batch.instanceCount;
+        batch.instanceCount = 0;
+    }
+
+    this->instances.resize(instanceCount);
+    for (size_t v = 0; v < visibleCount; v++) {
+        unsigned int i = (*visibleItems)[v];
+        instanceBatch* batch = &this->batches[this->itemBatches[v]];
+        instanceData* instance = &this->instances[batch->firstInstance + batch->instanceCount++];
+        instance->modelMatrix = (*modelMatrices)[i];
+        instance->edgesColor = (*items)[i].edgesColor;
+        instance->normalMatrix = (*normalMatrices)[i];
+    }
+
+    //orphans last frame's storage instead of waiting for the draws still reading it
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, this->instances.size() * sizeof(instanceData), this->instances.data(), GL_STREAM_DRAW);
+}
+
+void instancedRenderer::bindBatch(const instanceBatch* batch) {
+    glBindVertexArray(batch->VAO);
+    //the instance attributes of the mesh's VAO point at this batch's slice of the shared buffer
+    glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer);
+    size_t offset = batch->firstInstance * sizeof(instanceData);
+    for (int column = 0; column < 4; column++) {
+        glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(instanceData), (void*)(offset + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(2 + column, 1);
+        glEnableVertexAttribArray(2 + column);
+    }
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(instanceData), (void*)(offset + sizeof(glm::mat4)));
+    glVertexAttribDivisor(6, 1);
+    glEnableVertexAttribArray(6);
+    for (int column = 0; column < 3; column++) {
+        glVertexAttribPointer(8 + column, 3, GL_FLOAT, GL_FALSE, sizeof(instanceData), (void*)(offset + offsetof(instanceData, normalMatrix) + column * sizeof(glm::vec3)));
+        glVertexAttribDivisor(8 + column, 1);
+        glEnableVertexAttribArray(8 + column);
+    }
+}
+
+void instancedRenderer::drawBatch(const instanceBatch* batch) {
+    this->bindBatch(batch);
+    glDrawElementsInstanced(GL_TRIANGLES, batch->indexCount, GL_UNSIGNED_INT, 0, batch->instanceCount);
+}
+
+void instancedRenderer::drawBatchPoints(const instanceBatch* batch) {
+    this->bindBatch(batch);
+    glDrawArraysInstanced(GL_POINTS, 0, batch->vertexCount, batch->instanceCount);
+}
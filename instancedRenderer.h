@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+
+#include "gameItem.h"
+
+using namespace std;
+
+//per instance attributes read by vertexShader.glsl at locations 2 (model matrix, 4 columns), 6 (edges color)
+//and 8 (normal matrix, 3 columns)
+struct instanceData {
+    glm::mat4 modelMatrix;
+    glm::vec4 edgesColor;
+    glm::mat3 normalMatrix;
+}typedef instanceData;
+
+//items sharing a mesh and a texture, drawn with one glDrawElementsInstanced
+struct instanceBatch {
+    unsigned int VAO;
+    unsigned int texture;
+    unsigned int indexCount;
+    unsigned int vertexCount;   // unique vertices of the mesh, drawn once each by the vertex marker pass
+    unsigned int firstItem;     // an item of the batch, to reach the mesh data
+    unsigned int firstInstance;
+    unsigned int instanceCount;
+}typedef instanceBatch;
+
+class instancedRenderer {
+public:
+    vector<instanceBatch> batches;
+    bool reusedInstances;       // the last prepare kept the batches and the instance data of the one before
+
+    instancedRenderer() : reusedInstances(false), instanceBuffer(0) {}
+    void create();
+    void destroy();
+    //groups the visible items by mesh and texture and uploads all their instance data in one buffer write
+    //nothing is rebuilt or uploaded when the same items are visible and itemsChanged is false
+    void prepare(vector<gameItem>* items, const vector<unsigned int>* visibleItems, const vector<glm::mat4>* modelMatrices,
+        const vector<glm::mat3>* normalMatrices, bool itemsChanged);
+    void drawBatch(const instanceBatch* batch);
+    //every vertex of the mesh as a point, once per instance
+    void drawBatchPoints(const instanceBatch* batch);
+    unsigned int getInstanceBuffer() {
+        return this->instanceBuffer;
+    }
+
+private:
+    unsigned int instanceBuffer;
+    vector<instanceData> instances;
+    vector<unsigned int> itemBatches;   // batch of each visible item
+    vector<unsigned int> preparedItems; // visible items of the data in instanceBuffer
+    unordered_map<uint64_t, unsigned int> batchByKey;
+
+    void bindBatch(const instanceBatch* batch);
+};
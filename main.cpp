@@ -3,6 +3,7 @@
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <map>
 
 #include "glad/glad.h"
 #include <GLFW/glfw3.h>
@@ -19,6 +20,21 @@
 #include "imgui_impl_opengl3.h"
 
 #include "gameItem.h"
+#include "shader.h"
+#include "uniformBuffer.h"
+#include "instancedRenderer.h"
+#include "indirectRenderer.h"
+#include "frustum.h"
+#include "cullingSoA.h"
+#include "sceneBvh.h"
+#include "meshBvh.h"
+#include "benchmarks.h"
+#include "textureLoader.h"
+#include "textureCache.h"
+#include "programCache.h"
+#include "fileWatcher.h"
+#include "transformStore.h"
+#include "camera.h"
 
 #define X glm::vec3(1.f,.0f,.0f)
 #define Y glm::vec3(0.f,1.f,.0f)
@@ -29,6 +45,8 @@
 
 #define TARGET_UPS 60.
 #define SECOND_PER_UPDATE 1./TARGET_UPS
+#define MAX_TEXTURE_UPLOADS_PER_FRAME 4
+#define MAX_SHADER_PROGRAMS_FINISHED_PER_FRAME 1
 
 using namespace std;
 
@@ -36,38 +54,6 @@ void error_callback(int error, const char* description) {
     fprintf(stderr, "Error: %s\n", description);
 }
 
-string readFile(const char* filename) {
-
-    // 1. retrieve the shader source code from filePath
-    std::string shaderCode;
-    std::string fragmentCode;
-    std::ifstream shaderFile;
-    // ensure ifstream objects can throw exceptions:
-    shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try {
-        // open files
-        shaderFile.open(filename);
-        std::stringstream shaderStream;
-        // read file's buffer contents into streams
-        shaderStream << shaderFile.rdbuf();
-        // close file handlers
-        shaderFile.close();
-        // convert stream into string
-        shaderCode = shaderStream.str();
-    }
-    catch (std::ifstream::failure e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-    }
-    return shaderCode;
-}
-
-glm::vec3 rotate3(glm::vec3 v, float angle, glm::vec3 axis) {
-
-    glm::vec4 v4 = glm::vec4(v.x, v.y, v.z, 1.0f);
-    v4 = glm::rotate(glm::mat4(1.0f), angle, axis) * v4;
-
-    return glm::vec3(v4.x, v4.y, v4.z);
-}
 glm::vec3 normalize(glm::vec3 v) {
     float n = sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
     if (n < 0.000001) {
@@ -121,14 +107,79 @@ struct mouseParams {
     mouseParams() : mouseSensivity(glm::vec2(1.f, 1.f)) {}
 }typedef mouseParams;
 
+enum renderMode {
+    RENDER_DIRECT,      // one draw per item
+    RENDER_INSTANCED,   // one instanced draw per mesh and texture
+    RENDER_INDIRECT,    // shared mesh buffers, one multi draw indirect per texture
+};
+const char* renderModeNames[] = { "Direct", "Instanced", "Indirect" };
+
+//feature flags of the scene programs, each combination is its own program (see fragmentShader.glsl)
+enum sceneShaderFlags {
+    SCENE_SHOW_NORMALS = 1 << 0,    // adds the geometry stage
+    SCENE_EDGES = 1 << 1,
+    SCENE_BACK_SIDE_EDGES = 1 << 2,
+};
+const vector<string> sceneShaderFlagNames = { "SHOW_NORMALS", "EDGES", "BACK_SIDE_EDGES" };
+
+//the permutation used by a faces or edges pass for these overlays, BACK_SIDE_EDGES alone changes nothing so it is never selected
+unsigned int getSceneFlags(bool showNormals, bool showBackSideEdges, bool edges) {
+    //the geometry stage only runs when the normals are shown, the vertex markers have their own pass
+    unsigned int flags = (showNormals ? SCENE_SHOW_NORMALS : 0) | (edges ? SCENE_EDGES : 0);
+    if (showBackSideEdges && (showNormals || edges)) {
+        flags |= SCENE_BACK_SIDE_EDGES;
+    }
+    return flags;
+}
+
+enum markerShaderFlags {
+    MARKER_VERTEX_INDICES = 1 << 0,
+    MARKER_BACK_SIDE_EDGES = 1 << 1,
+};
+const vector<string> markerShaderFlagNames = { "VERTEX_INDICES", "BACK_SIDE_EDGES" };
+
+//locations of the uniforms of a scene program, resolved once after linking (per frame values are in the frameData block)
+struct sceneUniforms {
+    uniform<glm::mat4> modelMatrix;
+    uniform<glm::mat3> normalMatrix;
+    uniform<bool> instanced;
+    uniform<glm::vec4> edgesColor;
+    uniform<int> materialTexture;
+    void resolve(shader* s) {
+        modelMatrix = s->getUniform<glm::mat4>("modelMatrix");
+        normalMatrix = s->getUniform<glm::mat3>("normalMatrix");
+        instanced = s->getUniform<bool>("instanced");
+        edgesColor = s->getUniform<glm::vec4>("itemEdgesColor");
+        materialTexture = s->getUniform<int>("materialTexture");
+    }
+}typedef sceneUniforms;
+
+//locations of the uniforms of a vertex marker program
+struct markerUniforms {
+    uniform<glm::mat4> modelMatrix;
+    uniform<bool> instanced;
+    uniform<glm::vec4> edgesColor;
+    uniform<int> numbersTexture;
+    uniform<float> pointSize;
+    void resolve(shader* s) {
+        modelMatrix = s->getUniform<glm::mat4>("modelMatrix");
+        instanced = s->getUniform<bool>("instanced");
+        edgesColor = s->getUniform<glm::vec4>("itemEdgesColor");
+        numbersTexture = s->getUniform<int>("numbersTexture");
+        pointSize = s->getUniform<float>("pointSize");
+    }
+}typedef markerUniforms;
+
 struct gameState {
     glm::vec2 mousePos;
     glm::vec2 lastMousePos;
+    glm::vec2 cameraMousePos;   // cursor position the camera was last turned from
     float forward;
     float sideways;
     float upwards;
     float running;
     bool key_ESCAPE;
+    bool mouseLeftPressed;
     //hud parameters
     bool showFaces;
     bool showEdges;
@@ -143,23 +194,54 @@ struct gameState {
     long int tick;
     bool isGamePaused;
     bool nextStep;
-    gameItem* gameItems;
-    int gameItemCount;
+    vector<gameItem> gameItems;
+    int baseItemCount;      // items of the scene, the stress test copies come after them
+    transformStore transforms;          // of every item, created in item order, removed from the end and only parented to earlier items so that the dense index of an item's transform is its index in gameItems
+    int stressTestCount;
     unsigned int numberTexture;
-    unsigned int shaderProgram;
+    shaderPermutations sceneShaders;    // faces, edges and normals
+    unordered_map<unsigned int, sceneUniforms> sceneShaderUniforms;     // by GL program
+    sceneUniforms* uniforms;            // of the scene program in use
+    shaderPermutations markerShaders;   // vertices and vertex indices, one point sprite per vertex
+    unordered_map<unsigned int, markerUniforms> markerShaderUniforms;   // by GL program
+    fileWatcher shaderWatcher;          // the GLSL files, reloaded when saved
+    int shaderReloadCount;
+    string shaderReloadErrors;          // of the last reload, empty if it succeeded
+    frameUniformBuffer frameUniforms;
+    int renderMode;
+    bool frustumCulling;
+    unsigned int recomputedMatrices;    // model matrices of the items that changed this frame
+    bool instancesChanged;              // a matrix, an edges color or the item list changed since the instance data was last uploaded
+    vector<unsigned int> visibleItems;  // items that passed the frustum test this frame
+    boundsSoA itemBounds;               // world bounding spheres of every item, input of the culling kernel
+    vector<unsigned int> sphereVisibleItems;
+    bool bvhCulling;
+    sceneBvh bvh;                       // over the world AABBs of every item
+    vector<glm::vec3> itemsMin;         // world AABBs given to the bvh when it is rebuilt
+    vector<glm::vec3> itemsMax;
+    map<unsigned int, meshBvh> meshBvhs;    // triangle bvh of each mesh (keyed by VAO), built the first time a ray reaches it
+    bool pickRequested;
+    glm::vec2 pickPos;                      // cursor position of the click, in [0, 1] across the window
+    int pickedItem;                         // -1 when nothing is picked
+    meshRayHit pickedHit;
+    instancedRenderer instancing;
+    indirectRenderer indirect;
+    double renderCpuTime;
     float fov;
     glm::vec4 clearColor;
     float getIngameTime() {
         return (float)this->tick * SECOND_PER_UPDATE;
     }
-    gameState(gameItem* gameItems, int gameItemCount, unsigned int shaderProgram) :
+    gameState(vector<gameItem> gameItems) :
         mousePos(glm::vec2(0.f)),
         lastMousePos(glm::vec2(0.)),
+        cameraMousePos(glm::vec2(0.)),
         forward(0.f),
         sideways(0.f),
         upwards(0.f),
         running(0.f),
         key_ESCAPE(false),
+        mouseLeftPressed(false),
         //hud parameters
         showFaces(1),
         showEdges(0),
@@ -176,39 +258,50 @@ struct gameState {
         isGamePaused(false),
         nextStep(false),
         gameItems(gameItems),
-        gameItemCount(gameItemCount),
-        shaderProgram(shaderProgram),
+        baseItemCount(gameItems.size()),
+        stressTestCount(1000),
+        uniforms(NULL),
+        shaderReloadCount(0),
+        renderMode(RENDER_INSTANCED),
+        frustumCulling(true),
+        recomputedMatrices(0),
+        instancesChanged(true),
+        bvhCulling(true),
+        pickRequested(false),
+        pickedItem(-1),
+        renderCpuTime(0.),
         fov(60.),
         clearColor(glm::vec4(135. / 255., 209. / 255., 235 / 255., 1.)) {
+        for (gameItem& item : this->gameItems) {
+            item.transform = this->transforms.create();
+        }
         this->numberTexture = gameItem::loadTexture("numbers.png");
-        glUseProgram(this->shaderProgram);
-        glUniform1i(glGetUniformLocation(this->shaderProgram, "numbersTexture"), 0);
-        glUniform1i(glGetUniformLocation(this->shaderProgram, "materialTexture"), 1);
+        this->sceneShaders.init("./vertexShader.glsl", "./fragmentShader.glsl", "./geometryShader.glsl", sceneShaderFlagNames, SCENE_SHOW_NORMALS);
+        this->markerShaders.init("./markerVertexShader.glsl", "./markerFragmentShader.glsl", NULL, markerShaderFlagNames);
+        //the fallbacks are built now, every other permutation render can select is submitted at once and swapped in when the
+        //driver is done with it (request ignores the ones already built or submitted)
+        this->sceneShaders.get(0);
+        this->sceneShaders.get(SCENE_EDGES);
+        this->markerShaders.get(0);
+        for (unsigned int overlays = 0; overlays < 8; overlays++) {
+            this->sceneShaders.request(getSceneFlags(overlays & 1, overlays & 2, overlays & 4));
+        }
+        //every marker combination is reachable
+        for (unsigned int flags = 0; flags < 1u << markerShaderFlagNames.size(); flags++) {
+            this->markerShaders.request(flags);
+        }
+        const char* shaderFiles[] = { "./vertexShader.glsl", "./geometryShader.glsl", "./fragmentShader.glsl", "./markerVertexShader.glsl", "./markerFragmentShader.glsl" };
+        for (const char* fileName : shaderFiles) {
+            if (!this->shaderWatcher.watch(fileName)) {
+                std::cout << "Failed to watch " << fileName << ", it will not be reloaded when saved" << std::endl;
+            }
+        }
+        this->frameUniforms.create();
+        this->instancing.create();
+        this->indirect.create();
     }
 } typedef gameState;
 
-struct camera {
-    glm::vec3 position;
-    glm::vec2 angleRotation;
-    glm::vec3 relativeXAxis;
-    glm::vec3 relativeZAxis;
-    float speed;
-    float runningSpeedFactor;
-    void reset() {
-        position = glm::vec3(0.f, 1.0f, 2.0f);
-        angleRotation = glm::vec2(0., 0.);
-        relativeZAxis = Z;
-        relativeXAxis = X;
-    }
-    camera() :
-        position(glm::vec3(0.f, 1.0f, 2.0f)),
-        angleRotation(glm::vec2(0., 0.)),
-        relativeZAxis(Z),
-        speed(0.02f),
-        runningSpeedFactor(5.0) {}
-
-}typedef camera;
-
 struct renderData {
     unsigned int VAO;
     unsigned int VAO2;
@@ -221,55 +314,38 @@ struct renderData {
         texture(texture) {}
 }typedef renderData;
 
-unsigned int compileShader(const char* fileName, unsigned int shaderType) {
-
-    unsigned int shader;
-    shader = glCreateShader(shaderType);
-    if (fileName == NULL) return shader;
-    string sourceString = readFile(fileName);
-    const char* shaderSource = sourceString.c_str();
-    glShaderSource(shader, 1, &shaderSource, NULL);
-    glCompileShader(shader);
-
-    //check for compilation errors
-    int  success;
-    char infoLog[512];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        cout << "ERROR::SHADER::COMPILATION_FAILED\n" << fileName << " : " << infoLog << endl;
-    }
-    return shader;
+//copies of the first item laid out on a grid, they share its mesh and texture
+void spawnStressTestCubes(gameState* gs, int count) {
+    for (int i = (int)gs->gameItems.size() - 1; i >= gs->baseItemCount; i--) {
+        gameItem::releaseTexture(gs->gameItems[i].texture);
+        gs->transforms.destroy(gs->gameItems[i].transform);
+    }
+    gs->instancesChanged = true;
+    gs->gameItems.erase(gs->gameItems.begin() + gs->baseItemCount, gs->gameItems.end());
+    gs->gameItems.reserve(gs->baseItemCount + count);
+    int side = (int)ceil(sqrt((float)count));
+    for (int i = 0; i < count; i++) {
+        gameItem item = gs->gameItems[0];
+        item.name = "Stress test cube";
+        item.transform = gs->transforms.create(glm::vec3(-2.f * (i % side - side / 2), -2.f, 2.f * (i / side) + 5.f), glm::vec3(1.f),
+            normalize(glm::vec3((float)(i % 7), 1.f, (float)(i % 3))), 0.f);
+        gameItem::retainTexture(item.texture);
+        gs->gameItems.push_back(item);
+    }
 }
-unsigned int buildShaderProgram(const char* vertexShaderFileName, const char* fragmentShaderFileName, const char* geometryShaderFileName = NULL) {
-    unsigned int vertexShader = compileShader(vertexShaderFileName, GL_VERTEX_SHADER);
-    unsigned int geometryShader = compileShader(geometryShaderFileName, GL_GEOMETRY_SHADER);
-    unsigned int fragmentShader = compileShader(fragmentShaderFileName, GL_FRAGMENT_SHADER);
 
-    unsigned int shaderProgram;
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    if (geometryShaderFileName != NULL)
-        glAttachShader(shaderProgram, geometryShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    //check for errors
-    int  success;
-    char infoLog[512];
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        cout << "ERROR LINKING SHADER PROGRAM : " << infoLog << endl;
-    }
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(geometryShader);
-    glDeleteShader(fragmentShader);
-    return shaderProgram;
+//textures merged by textureCache into another one with the same content, their references already moved to it
+void replaceMergedTextures(gameState* gs, const vector<pair<unsigned int, unsigned int>>& mergedTextures) {
+    for (const pair<unsigned int, unsigned int>& merged : mergedTextures) {
+        for (gameItem& item : gs->gameItems) {
+            if (item.texture == merged.first) item.texture = merged.second;
+        }
+        if (gs->numberTexture == merged.first) gs->numberTexture = merged.second;
+    }
+    //the batches are keyed by texture
+    gs->instancesChanged = true;
 }
 
-
 bool onePressToggle(GLFWwindow* window, int key, bool* was_pressed, bool* toggle) {
     bool toggled = false;
     if (glfwGetKey(window, key) == GLFW_PRESS) {
@@ -300,12 +376,22 @@ void processInputs(GLFWwindow* window, windowParams* wp, gameState* gs, mousePar
         else {
             glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
             glfwSetCursorPos(window, gs->lastMousePos.x, gs->lastMousePos.y);
+            gs->cameraMousePos = gs->lastMousePos;
 
         }
     }
     double mx, my;
     glfwGetCursorPos(window, &mx, &my);
     gs->mousePos = glm::vec2((float)mx * mp->mouseSensivity.x, (float)my * mp->mouseSensivity.x);
+    //left click in debug mode picks the triangle under the cursor
+    bool mouseLeft = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    if (gs->debugMode && mouseLeft && !gs->mouseLeftPressed && !ImGui::GetIO().WantCaptureMouse) {
+        int windowWidth, windowHeight;
+        glfwGetWindowSize(window, &windowWidth, &windowHeight);
+        gs->pickRequested = true;
+        gs->pickPos = glm::vec2((float)mx / windowWidth, (float)my / windowHeight);
+    }
+    gs->mouseLeftPressed = mouseLeft;
 
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
         gs->forward = 1;
@@ -351,6 +437,23 @@ void processInputs(GLFWwindow* window, windowParams* wp, gameState* gs, mousePar
         ImGui::Checkbox("Show edges", &(gs->showEdges));
         ImGui::Checkbox("Show back side edges", &(gs->showBackSideEdges));
         ImGui::Checkbox("Show normals", &(gs->showNormals));
+        ImGui::Text("geometry shader : %s\nshader permutations : %d scene, %d marker, %d compiling, %d failed\n%s", gs->showNormals ? "on" : "off",
+            gs->sceneShaders.getProgramCount(), gs->markerShaders.getProgramCount(),
+            gs->sceneShaders.getPendingCount() + gs->markerShaders.getPendingCount(),
+            gs->sceneShaders.getFailedCount() + gs->markerShaders.getFailedCount(),
+            supportsParallelShaderCompile() ? "parallel shader compile" : "no parallel shader compile, one program finished per frame");
+        if (!gs->shaderReloadErrors.empty()) {
+            ImGui::TextColored(ImVec4(1.f, 0.3f, 0.3f, 1.f), "Shader reload failed, the previous programs are kept :");
+            ImGui::TextWrapped("%s", gs->shaderReloadErrors.c_str());
+        }
+        else if (gs->shaderReloadCount > 0) {
+            ImGui::Text("shaders reloaded %d times", gs->shaderReloadCount);
+        }
+        programCache* binaries = programCache::get();
+        ImGui::Checkbox("Program binary cache", &(binaries->enabled));
+        ImGui::Text("%s\nloaded : %d in %.2f ms (%.2f ms of compilation saved)\ncompiled : %d, rejected : %d",
+            binaries->isSupported() ? "program binaries supported" : "no program binary format",
+            binaries->hits, binaries->loadSeconds * 1000., binaries->compileSecondsSaved * 1000., binaries->misses, binaries->rejected);
         if (ImGui::Checkbox("Back Face Culling", &(gs->backFaceCulling))) {
             if (gs->backFaceCulling) {
                 glEnable(GL_CULL_FACE);
@@ -360,6 +463,16 @@ void processInputs(GLFWwindow* window, windowParams* wp, gameState* gs, mousePar
             }
         }
         ImGui::SliderFloat("Normal size", &(gs->normalSize), 0.5, 10.);
+        ImGui::Combo("Render mode", &(gs->renderMode), renderModeNames, 3);
+        ImGui::Checkbox("Frustum culling", &(gs->frustumCulling));
+        ImGui::Checkbox("BVH culling", &(gs->bvhCulling));
+        ImGui::Text("bvh : %d nodes, %d refitted this frame", (int)gs->bvh.nodes.size(), (int)gs->bvh.refittedNodeCount);
+        ImGui::Text("visible items : %d\nculled items : %d", (int)gs->visibleItems.size(), (int)(gs->gameItems.size() - gs->visibleItems.size()));
+        if (gs->renderMode == RENDER_INDIRECT) {
+            ImGui::Checkbox("Multi draw indirect", &(gs->indirect.useMultiDraw));
+            ImGui::Text("%s, %d meshes in the arena, %d draw calls",
+                gs->indirect.supportsMultiDraw() ? "GL 4.3" : "no GL 4.3, CPU loop", gs->indirect.getMeshCount(), gs->indirect.drawCallCount);
+        }
         if (ImGui::ColorEdit4("Clear color", &(gs->clearColor.x))) {
             glClearColor(gs->clearColor.x, gs->clearColor.y, gs->clearColor.z, gs->clearColor.w);
         }
@@ -389,32 +502,71 @@ void processInputs(GLFWwindow* window, windowParams* wp, gameState* gs, mousePar
         }
         ImGui::TreePop();
     }
+    if (ImGui::TreeNodeEx("Textures")) {
+        textureCache* cache = textureCache::get();
+        ImGui::Checkbox("Dedup by content", &(cache->dedupByContent));
+        ImGui::Text("textures : %d\nhits : %d\nmisses : %d\nbytes saved : %zu KB",
+            cache->getTextureCount(), cache->hits, cache->misses, cache->bytesSaved / 1024);
+        ImGui::TreePop();
+    }
     if (ImGui::TreeNodeEx("Game Items")) {
-        for (int i = 0;i < gs->gameItemCount;i++) {
+        for (int i = 0;i < gs->baseItemCount;i++) {
             if (ImGui::TreeNodeEx(gs->gameItems[i].name)) {
+                transformHandle transform = gs->gameItems[i].transform;
 
                 if (ImGui::TreeNodeEx("Scale")) {
-                    ImGui::SliderFloat("Cube scale x", &(gs->gameItems[i].scale.x), 0.1, 10);
-                    ImGui::SliderFloat("Cube scale y", &(gs->gameItems[i].scale.y), 0.1, 10);
-                    ImGui::SliderFloat("Cube scale z", &(gs->gameItems[i].scale.z), 0.1, 10);
+                    glm::vec3 scale = gs->transforms.getScale(transform);
+                    bool changed = ImGui::SliderFloat("Cube scale x", &(scale.x), 0.1, 10);
+                    changed |= ImGui::SliderFloat("Cube scale y", &(scale.y), 0.1, 10);
+                    changed |= ImGui::SliderFloat("Cube scale z", &(scale.z), 0.1, 10);
+                    if (changed) {
+                        gs->transforms.setScale(transform, scale);
+                    }
                     ImGui::TreePop();
                 }
 
                 if (ImGui::TreeNodeEx("Position")) {
-                    ImGui::SliderFloat("Cube position x", &(gs->gameItems[i].position.x), -10, 10);
-                    ImGui::SliderFloat("Cube position y", &(gs->gameItems[i].position.y), -10, 10);
-                    ImGui::SliderFloat("Cube position z", &(gs->gameItems[i].position.z), -10, 10);
+                    glm::vec3 position = gs->transforms.getPosition(transform);
+                    bool changed = ImGui::SliderFloat("Cube position x", &(position.x), -10, 10);
+                    changed |= ImGui::SliderFloat("Cube position y", &(position.y), -10, 10);
+                    changed |= ImGui::SliderFloat("Cube position z", &(position.z), -10, 10);
+                    if (changed) {
+                        gs->transforms.setPosition(transform, position);
+                    }
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNodeEx("Parent")) {
+                    //only the items before this one, so that the transforms keep the order of gameItems
+                    transformHandle parent = gs->transforms.getParent(transform);
+                    if (ImGui::RadioButton("None", parent == INVALID_TRANSFORM)) {
+                        gs->transforms.setParent(transform, INVALID_TRANSFORM);
+                    }
+                    for (int j = 0; j < i; j++) {
+                        ImGui::PushID(j);
+                        if (ImGui::RadioButton(gs->gameItems[j].name, parent == gs->gameItems[j].transform)) {
+                            gs->transforms.setParent(transform, gs->gameItems[j].transform);
+                        }
+                        ImGui::PopID();
+                    }
                     ImGui::TreePop();
                 }
 
                 if (ImGui::TreeNodeEx("Rotation")) {
-                    ImGui::SliderFloat("Cube rotation axis x", &(gs->gameItems[i].rotationAxis.x), -1., 1.);
-                    ImGui::SliderFloat("Cube rotation axis y", &(gs->gameItems[i].rotationAxis.y), -1., 1.);
-                    ImGui::SliderFloat("Cube rotation axis z", &(gs->gameItems[i].rotationAxis.z), -1., 1.);
-                    ImGui::SliderFloat("Cube rotation angle", &(gs->gameItems[i].rotationAngle), -3. * M_PI, 3. * M_PI);
+                    glm::vec3 axis = gs->transforms.getRotationAxis(transform);
+                    float angle = gs->transforms.getRotationAngle(transform);
+                    bool changed = ImGui::SliderFloat("Cube rotation axis x", &(axis.x), -1., 1.);
+                    changed |= ImGui::SliderFloat("Cube rotation axis y", &(axis.y), -1., 1.);
+                    changed |= ImGui::SliderFloat("Cube rotation axis z", &(axis.z), -1., 1.);
+                    changed |= ImGui::SliderFloat("Cube rotation angle", &angle, -3. * M_PI, 3. * M_PI);
+                    if (changed) {
+                        gs->transforms.setRotation(transform, axis, angle);
+                    }
                     ImGui::TreePop();
                 }
-                ImGui::ColorEdit4("Edges Color", &(gs->gameItems[i].edgesColor.x));
+                if (ImGui::ColorEdit4("Edges Color", &(gs->gameItems[i].edgesColor.x))) {
+                    gs->instancesChanged = true;
+                }
 
                 ImGui::TreePop();
             }
@@ -422,6 +574,62 @@ void processInputs(GLFWwindow* window, windowParams* wp, gameState* gs, mousePar
         ImGui::TreePop();
 
     }
+    if (ImGui::TreeNodeEx("Picking")) {
+        ImGui::Text("Left click an item in debug mode to pick a triangle");
+        if (gs->pickedItem != -1 && gs->pickedItem < (int)gs->gameItems.size()) {
+            gameItem* item = &gs->gameItems[gs->pickedItem];
+            //the nearest corner is the one with the biggest barycentric weight
+            float weights[3] = { 1.f - gs->pickedHit.u - gs->pickedHit.v, gs->pickedHit.u, gs->pickedHit.v };
+            int corner = weights[0] > weights[1] ? (weights[0] > weights[2] ? 0 : 2) : (weights[1] > weights[2] ? 1 : 2);
+            ImGui::Text("item : %d (%s)\ntriangle : %u\nbarycentrics : %.3f %.3f %.3f\nnearest vertex : %u", gs->pickedItem, item->name,
+                gs->pickedHit.triangle, weights[0], weights[1], weights[2], item->getSourceVertex(item->indices[3 * gs->pickedHit.triangle + corner]));
+        }
+        else {
+            ImGui::Text("nothing picked");
+        }
+        ImGui::Text("%d triangle bvhs built", (int)gs->meshBvhs.size());
+        ImGui::TreePop();
+    }
+    if (ImGui::TreeNodeEx("Stress test")) {
+        ImGui::SliderInt("Cube count", &(gs->stressTestCount), 0, 100000);
+        if (ImGui::Button("Spawn")) {
+            spawnStressTestCubes(gs, gs->stressTestCount);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Clear")) {
+            spawnStressTestCubes(gs, 0);
+        }
+        ImGui::Text("items : %d\ninstanced batches : %d\nmatrices recomputed : %u\ninstance data : %s", (int)gs->gameItems.size(), (int)gs->instancing.batches.size(),
+            gs->recomputedMatrices, gs->instancing.reusedInstances ? "reused" : "uploaded");
+        ImGui::TreePop();
+    }
+    if (ImGui::TreeNodeEx("Benchmarks")) {
+        if (ImGui::Button("Obj parsing")) {
+            benchmarkObjParsing();
+        }
+        if (ImGui::Button("Mesh cache")) {
+            benchmarkMeshCache();
+        }
+        if (ImGui::Button("Frustum culling")) {
+            benchmarkCulling();
+        }
+        if (ImGui::Button("Scene BVH")) {
+            benchmarkSceneBvh();
+        }
+        if (ImGui::Button("Mesh BVH")) {
+            benchmarkMeshBvh();
+        }
+        if (ImGui::Button("Transforms")) {
+            benchmarkTransforms();
+        }
+        if (ImGui::Button("Transform hierarchy")) {
+            benchmarkTransformHierarchy();
+        }
+        if (ImGui::Button("Batch math")) {
+            benchmarkBatchMath();
+        }
+        ImGui::TreePop();
+    }
 
 
 
@@ -433,38 +641,260 @@ void update(gameState* gs, windowParams* wp, camera* cam) {
 
     //Camera mouvement
     float camSpeed = cam->speed * (1.f + gs->running * (cam->runningSpeedFactor - 1.f));
-    cam->position += normalize(cam->relativeZAxis * gs->forward + cam->relativeXAxis * gs->sideways + Y * gs->upwards) * camSpeed;
+    glm::vec3 direction = cam->relativeZAxis * gs->forward + cam->relativeXAxis * gs->sideways + Y * gs->upwards;
+    if (direction != glm::vec3(0.f)) {
+        cam->move(normalize(direction) * camSpeed);
+    }
+
+}
+
+
+//model matrices of the items that changed, and the list of those inside the view frustum
+void cullItems(gameState* gs, const glm::mat4& viewProjMatrix) {
+    frustum viewFrustum;
+    viewFrustum.extract(viewProjMatrix);
+    unsigned int itemCount = gs->gameItems.size();
+    gs->itemBounds.resize(itemCount);
+    gs->recomputedMatrices = gs->transforms.updateModelMatrices();
+    gs->instancesChanged |= gs->recomputedMatrices > 0;
+    //the bvh is rebuilt when items are added or removed, refitted when some of them moved
+    if (gs->bvh.getItemCount() != itemCount) {
+        gs->itemsMin.resize(itemCount);
+        gs->itemsMax.resize(itemCount);
+        for (unsigned int i = 0; i < itemCount; i++) {
+            glm::vec3 center, halfExtents;
+            float radius;
+            gs->gameItems[i].getWorldBounds(gs->transforms.modelMatrices[i], &center, &radius, &halfExtents);
+            gs->itemBounds.set(i, center, radius);
+            gs->itemsMin[i] = center - halfExtents;
+            gs->itemsMax[i] = center + halfExtents;
+        }
+        gs->bvh.build(gs->itemsMin, gs->itemsMax);
+    }
+    else if (gs->recomputedMatrices > 0) {
+        for (unsigned int i : gs->transforms.changedIndices) {
+            glm::vec3 center, halfExtents;
+            float radius;
+            gs->gameItems[i].getWorldBounds(gs->transforms.modelMatrices[i], &center, &radius, &halfExtents);
+            gs->itemBounds.set(i, center, radius);
+            gs->bvh.setItemBounds(i, center - halfExtents, center + halfExtents);
+        }
+        gs->bvh.refit();
+    }
+
+    gs->visibleItems.clear();
+    if (!gs->frustumCulling) {
+        for (unsigned int i = 0; i < itemCount; i++) {
+            gs->visibleItems.push_back(i);
+        }
+        return;
+    }
+    if (gs->bvhCulling) {
+        gs->bvh.cullFrustum(&viewFrustum, &gs->visibleItems);
+        return;
+    }
+    //the sphere test runs on all items at once, the box test removes what the spheres let through
+    cullSpheres(&viewFrustum, &gs->itemBounds, &gs->sphereVisibleItems);
+    for (unsigned int i : gs->sphereVisibleItems) {
+        glm::vec3 center, halfExtents;
+        float radius;
+        gs->gameItems[i].getWorldBounds(gs->transforms.modelMatrices[i], &center, &radius, &halfExtents);
+        if (viewFrustum.intersectsBox(center, halfExtents)) {
+            gs->visibleItems.push_back(i);
+        }
+    }
+}
+
+//nearest triangle under the cursor : the scene bvh finds the candidate items, their triangle bvh is queried in model space
+void pickItem(gameState* gs, const glm::mat4& inverseViewProj) {
+    glm::vec2 ndc = glm::vec2(2.f * gs->pickPos.x - 1.f, 1.f - 2.f * gs->pickPos.y);
+    glm::vec4 nearPoint = inverseViewProj * glm::vec4(ndc.x, ndc.y, -1.f, 1.f);
+    glm::vec4 farPoint = inverseViewProj * glm::vec4(ndc.x, ndc.y, 1.f, 1.f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+
+    meshRayHit nearestHit;
+    float distance;
+    int picked = gs->bvh.raycast(origin, direction, &distance, [&](unsigned int i, float maxDistance, float* itemDistance) {
+        gameItem* item = &gs->gameItems[i];
+        meshBvh* mesh = &gs->meshBvhs[item->VAO];
+        if (!mesh->isBuilt()) {
+            mesh->build(item->vertices, VERTEX_SIZE, item->indices, item->indexCount);
+            std::cout << "Built the triangle bvh of " << item->name << " : " << item->indexCount / 3 << " triangles, "
+                << mesh->nodes.size() << " nodes in " << mesh->buildSeconds * 1000. << " ms" << std::endl;
+        }
+        //the ray parameter is the same in both spaces as long as the direction is not normalized
+        glm::mat4 inverseModelMatrix = glm::inverse(gs->transforms.modelMatrices[i]);
+        glm::vec3 localOrigin = glm::vec3(inverseModelMatrix * glm::vec4(origin, 1.f));
+        glm::vec3 localDirection = glm::vec3(inverseModelMatrix * glm::vec4(direction, 0.f));
+        meshRayHit hit;
+        if (!mesh->intersect(localOrigin, localDirection, maxDistance, &hit)) {
+            return false;
+        }
+        //only hits closer than maxDistance come back, so this is the nearest one so far
+        nearestHit = hit;
+        *itemDistance = hit.distance;
+        return true;
+    });
+    gs->pickedItem = picked;
+    if (picked != -1) {
+        gs->pickedHit = nearestHit;
+    }
+}
+
+//rebuilds the permutation sets whose files were saved, their uniforms are resolved again on their next use
+void reloadChangedShaders(gameState* gs) {
+    vector<string> changedFiles;
+    if (!gs->shaderWatcher.poll(&changedFiles)) {
+        return;
+    }
+    bool reloadScene = false, reloadMarkers = false;
+    for (const string& fileName : changedFiles) {
+        reloadScene = reloadScene || gs->sceneShaders.usesFile(fileName);
+        reloadMarkers = reloadMarkers || gs->markerShaders.usesFile(fileName);
+    }
+    string errors;
+    bool sceneReloaded = !reloadScene || gs->sceneShaders.reload(&errors);
+    bool markersReloaded = !reloadMarkers || gs->markerShaders.reload(&errors);
+    //the names of the deleted programs can be given again to the new ones
+    gs->sceneShaderUniforms.clear();
+    gs->markerShaderUniforms.clear();
+    gs->shaderReloadErrors = errors;
+    if (sceneReloaded && markersReloaded) {
+        gs->shaderReloadCount++;
+        std::cout << "Reloaded shaders after a change of " << changedFiles[0] << std::endl;
+    }
+}
+
+//uses the program of these flags, or the fallback one while it compiles, its uniforms are resolved the first time
+void useSceneProgram(gameState* gs, unsigned int flags) {
+    shader* program = gs->sceneShaders.getReady(flags, flags & SCENE_EDGES);
+    program->use();
+    auto found = gs->sceneShaderUniforms.find(program->program);
+    if (found == gs->sceneShaderUniforms.end()) {
+        found = gs->sceneShaderUniforms.insert(make_pair(program->program, sceneUniforms())).first;
+        found->second.resolve(program);
+        found->second.materialTexture.set(1);
+    }
+    gs->uniforms = &found->second;
+}
+
+markerUniforms* useMarkerProgram(gameState* gs, unsigned int flags) {
+    shader* program = gs->markerShaders.getReady(flags, 0);
+    program->use();
+    auto found = gs->markerShaderUniforms.find(program->program);
+    if (found == gs->markerShaderUniforms.end()) {
+        found = gs->markerShaderUniforms.insert(make_pair(program->program, markerUniforms())).first;
+        found->second.resolve(program);
+        found->second.numbersTexture.set(0);
+    }
+    return &found->second;
+}
 
+//faces are drawn with the texture of each item, edges without
+void drawItemsDirect(gameState* gs, bool edges) {
+    gs->uniforms->instanced.set(false);
+    for (unsigned int i : gs->visibleItems) {
+        gs->uniforms->edgesColor.set(gs->gameItems[i].edgesColor);
+        gs->uniforms->modelMatrix.set(gs->transforms.modelMatrices[i]);
+        gs->uniforms->normalMatrix.set(gs->transforms.normalMatrices[i]);
+        glBindVertexArray(gs->gameItems[i].VAO);
+        if (!edges) {
+            glBindTexture(GL_TEXTURE_2D, gs->gameItems[i].texture);
+        }
+        glDrawElements(GL_TRIANGLES, gs->gameItems[i].indexCount, GL_UNSIGNED_INT, 0);
+    }
 }
 
+void drawItemsInstanced(gameState* gs, bool edges) {
+    gs->uniforms->instanced.set(true);
+    for (instanceBatch& batch : gs->instancing.batches) {
+        if (!edges) {
+            glBindTexture(GL_TEXTURE_2D, batch.texture);
+        }
+        gs->instancing.drawBatch(&batch);
+    }
+}
+
+void drawItemsIndirect(gameState* gs, bool edges) {
+    gs->uniforms->instanced.set(true);
+    gs->indirect.draw(!edges);
+}
+
+//one pass over the visible items with the program in use
+void drawItems(gameState* gs, bool edges) {
+    if (edges) {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    }
+    else {
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(1.0f, 1.0f);
+    }
+    if (gs->renderMode == RENDER_INSTANCED) {
+        drawItemsInstanced(gs, edges);
+    }
+    else if (gs->renderMode == RENDER_INDIRECT) {
+        drawItemsIndirect(gs, edges);
+    }
+    else {
+        drawItemsDirect(gs, edges);
+    }
+    if (edges) {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+    else {
+        glDisable(GL_POLYGON_OFFSET_FILL);
+    }
+}
+
+//each vertex of the visible meshes drawn once as a point sprite, after the faces so the depth test sees them
+void drawVertexMarkers(gameState* gs, float pointSize) {
+    unsigned int flags = (gs->showVertexIndices ? MARKER_VERTEX_INDICES : 0) | (gs->showBackSideEdges ? MARKER_BACK_SIDE_EDGES : 0);
+    markerUniforms* markers = useMarkerProgram(gs, flags);
+    markers->pointSize.set(pointSize);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    if (gs->renderMode == RENDER_DIRECT) {
+        markers->instanced.set(false);
+        for (unsigned int i : gs->visibleItems) {
+            markers->edgesColor.set(gs->gameItems[i].edgesColor);
+            markers->modelMatrix.set(gs->transforms.modelMatrices[i]);
+            glBindVertexArray(gs->gameItems[i].VAO);
+            glDrawArrays(GL_POINTS, 0, gs->gameItems[i].uniqueVertexCount);
+        }
+    }
+    else {
+        //the instanced and indirect paths both left this frame's instance data in the batches
+        markers->instanced.set(true);
+        for (instanceBatch& batch : gs->instancing.batches) {
+            gs->instancing.drawBatchPoints(&batch);
+        }
+    }
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
 
 void render(GLFWwindow* window, windowParams* wp, camera* cam, gameState* gs) {
 
-    //Camera orientation
+    //Camera orientation, a window width of mouse movement turns it by one radian
     if (!gs->debugMode) {
-        cam->angleRotation = glm::vec2(-(-gs->mousePos.x + 0.5f * wp->width) / wp->width, -(-gs->mousePos.y + 0.5f * wp->height) / wp->height);
-        cam->relativeXAxis = rotate3(X, -cam->angleRotation.x, Y);
-        cam->relativeZAxis = rotate3(cam->relativeXAxis, glm::radians(90.0), Y);
-        cam->relativeZAxis = rotate3(cam->relativeZAxis, -cam->angleRotation.y, cam->relativeXAxis);
-    }
-    //camera setup
-    glm::mat4 viewMatrix = glm::mat4(1.0f);
-    viewMatrix = glm::rotate(viewMatrix, cam->angleRotation.x, Y);
-    viewMatrix = glm::rotate(viewMatrix, cam->angleRotation.y, cam->relativeXAxis);
-    viewMatrix = glm::translate(viewMatrix, -cam->position);
-    glm::mat4 projMatrix = glm::perspective(glm::radians(gs->fov), wp->ratio, 0.0001f, 100.0f);
+        glm::vec2 mouseDelta = gs->mousePos - gs->cameraMousePos;
+        cam->rotate(-mouseDelta.x / wp->width, -mouseDelta.y / wp->height);
+    }
+    gs->cameraMousePos = gs->mousePos;
+    cam->setPerspective(glm::radians(gs->fov), wp->ratio, 0.0001f, 100.0f);
     //update uniform variables
-    glUseProgram(gs->shaderProgram);
-    glUniformMatrix4fv(glGetUniformLocation(gs->shaderProgram, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(viewMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(gs->shaderProgram, "projMatrix"), 1, GL_FALSE, glm::value_ptr(projMatrix));
-    glUniform1f(glGetUniformLocation(gs->shaderProgram, "ratio"), wp->ratio);
-    glUniform1i(glGetUniformLocation(gs->shaderProgram, "showBackSideEdges"), gs->showBackSideEdges);
-    glUniform1i(glGetUniformLocation(gs->shaderProgram, "showNormals"), gs->showNormals);
-    glUniform1f(glGetUniformLocation(gs->shaderProgram, "normalSize"), gs->normalSize);
-    glUniform1i(glGetUniformLocation(gs->shaderProgram, "showVertexIndices"), gs->showVertexIndices);
-    glUniform1i(glGetUniformLocation(gs->shaderProgram, "showVertices"), gs->showVertices);
-    glUniform3fv(glGetUniformLocation(gs->shaderProgram, "camPos"), 1, glm::value_ptr(cam->position));
-    glUniform1f(glGetUniformLocation(gs->shaderProgram, "time"), gs->getIngameTime());
+    double renderStart = glfwGetTime();
+    frameUniformData frameData;
+    frameData.viewMatrix = cam->getViewMatrix();
+    frameData.projMatrix = cam->getProjMatrix();
+    frameData.camPos = cam->position;
+    frameData.ratio = wp->ratio;
+    frameData.time = gs->getIngameTime();
+    frameData.normalSize = gs->normalSize;
+    frameData.showNormals = gs->showNormals;
+    frameData.showVertexIndices = gs->showVertexIndices;
+    frameData.showVertices = gs->showVertices;
+    frameData.showBackSideEdges = gs->showBackSideEdges;
+    gs->frameUniforms.update(&frameData);
 
     //Draw
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -472,32 +902,38 @@ void render(GLFWwindow* window, windowParams* wp, camera* cam, gameState* gs) {
     glBindTexture(GL_TEXTURE_2D, gs->numberTexture);
     glActiveTexture(GL_TEXTURE1);
 
-    for (int i = 0; i < gs->gameItemCount; i++) {
-        glm::mat4 modelMatrix = glm::mat4(1.0);
-        modelMatrix = glm::translate(modelMatrix, -gs->gameItems[i].position);
-        modelMatrix = glm::rotate(modelMatrix, gs->gameItems[i].rotationAngle, gs->gameItems[i].rotationAxis);
-        modelMatrix = glm::scale(modelMatrix, gs->gameItems[i].scale);
-
-        glUniform1i(glGetUniformLocation(gs->shaderProgram, "isEdge"), false);
-        glUniform4fv(glGetUniformLocation(gs->shaderProgram, "edgesColor"), 1, glm::value_ptr(gs->gameItems[i].edgesColor));
-        glUniformMatrix4fv(glGetUniformLocation(gs->shaderProgram, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
-        glBindVertexArray(gs->gameItems[i].VAO);
-        if (gs->showFaces) {
-            glBindTexture(GL_TEXTURE_2D, gs->gameItems[i].texture);
-            glEnable(GL_POLYGON_OFFSET_FILL);
-            glPolygonOffset(1.0f, 1.0f);
-            glDrawElements(GL_TRIANGLES, gs->gameItems[i].indexCount, GL_UNSIGNED_INT, 0);
-            glDisable(GL_POLYGON_OFFSET_FILL);
-        }
-        if (gs->showEdges) {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            glUniform1i(glGetUniformLocation(gs->shaderProgram, "isEdge"), true);
-            glDrawElements(GL_TRIANGLES, gs->gameItems[i].indexCount, GL_UNSIGNED_INT, 0);
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-        }
+    cullItems(gs, cam->getViewProjMatrix());
+    if (gs->pickRequested) {
+        pickItem(gs, cam->getInverseViewProjMatrix());
+        gs->pickRequested = false;
+    }
+    if (gs->renderMode == RENDER_INSTANCED) {
+        gs->instancing.prepare(&gs->gameItems, &gs->visibleItems, &gs->transforms.modelMatrices, &gs->transforms.normalMatrices, gs->instancesChanged);
+        gs->instancesChanged = false;
+    }
+    else if (gs->renderMode == RENDER_INDIRECT) {
+        gs->indirect.prepare(&gs->gameItems, &gs->visibleItems, &gs->transforms.modelMatrices, &gs->transforms.normalMatrices, &gs->instancing, gs->instancesChanged);
+        gs->instancesChanged = false;
+    }
+    //the program is specialized for the overlays shown instead of branching on them for every fragment
+    if (gs->showFaces) {
+        useSceneProgram(gs, getSceneFlags(gs->showNormals, gs->showBackSideEdges, false));
+        drawItems(gs, false);
+    }
+    if (gs->showEdges) {
+        useSceneProgram(gs, getSceneFlags(gs->showNormals, gs->showBackSideEdges, true));
+        drawItems(gs, true);
+    }
+    if (gs->showVertices || gs->showVertexIndices) {
+        //same on screen size as the quads the geometry shader used to emit : 2 * size in NDC across the width
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        float size = gs->showVertexIndices ? 0.02f : 0.003f;
+        drawVertexMarkers(gs, size * framebufferWidth);
     }
 
+    gs->renderCpuTime = glfwGetTime() - renderStart;
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
@@ -552,21 +988,28 @@ int main() {
     };
     //-----------------------------------------------------------------------------------------
 
-    unsigned int shaderProgram = buildShaderProgram("./vertexShader.glsl", "./fragmentShader.glsl", "./geometryShader.glsl");
-
     glClearColor(135. / 255., 209. / 255., 235 / 255., 1.);
     glEnable(GL_DEPTH_TEST);
     glCullFace(GL_BACK);
 
     gameItem cube("Cube", vertices, sizeof(vertices) / sizeof(float), indices, sizeof(indices) / sizeof(int), "Carre.png");
     gameItem floor("Floor", vertices2, sizeof(vertices2) / sizeof(float), indices2, sizeof(indices2) / sizeof(int), "damier.png");
-    int gameItemCount = 2;
-    gameItem gameItems[] = { cube , floor };
-
-    gameState gs = gameState(gameItems, gameItemCount, shaderProgram);
+    gameItem objCube("Obj cube", "./untitled.obj", "tex.png");
+    vector<gameItem> gameItems = { cube , floor, objCube };
+
+    gameState gs = gameState(gameItems);
+    gs.transforms.setPosition(gs.gameItems[2].transform, glm::vec3(-3., -1., 0.));
+    programCache* binaries = programCache::get();
+    if (binaries->hits > 0) {
+        std::cout << "Loaded " << binaries->hits << " shader programs from cache in " << binaries->loadSeconds * 1000. << " ms, "
+            << (binaries->compileSecondsSaved - binaries->loadSeconds) * 1000. << " ms of startup saved" << std::endl;
+    }
     mouseParams mp = mouseParams();
     windowParams wp = windowParams();
     camera cam = camera();
+    double cursorX, cursorY;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    gs.cameraMousePos = glm::vec2((float)cursorX * mp.mouseSensivity.x, (float)cursorY * mp.mouseSensivity.x);
 
 
     double previous = glfwGetTime();
@@ -591,8 +1034,21 @@ int main() {
         }
         double t2 = glfwGetTime();
 
-        ImGui::Text("FPS : %f \nupdates per frame : %d\naverage update time : %f\nSECOND_PER_UPDATE : %f",
-            1. / elapsed, counter, (counter == 0 ? 0 : (t2 - t1) / (float)counter), SECOND_PER_UPDATE);
+        ImGui::Text("FPS : %f \nupdates per frame : %d\naverage update time : %f\nSECOND_PER_UPDATE : %f\nrender CPU time : %f ms",
+            1. / elapsed, counter, (counter == 0 ? 0 : (t2 - t1) / (float)counter), SECOND_PER_UPDATE, gs.renderCpuTime * 1000.);
+
+        vector<pair<unsigned int, unsigned int>> mergedTextures;
+        textureCache::get()->uploadPending(MAX_TEXTURE_UPLOADS_PER_FRAME, &mergedTextures);
+        if (!mergedTextures.empty()) {
+            replaceMergedTextures(&gs, mergedTextures);
+        }
+        gs.sceneShaders.poll(MAX_SHADER_PROGRAMS_FINISHED_PER_FRAME);
+        gs.markerShaders.poll(MAX_SHADER_PROGRAMS_FINISHED_PER_FRAME);
+        reloadChangedShaders(&gs);
+        unsigned int pendingTextures = textureLoader::get()->getPendingCount();
+        if (pendingTextures > 0) {
+            ImGui::Text("Loading textures : %d", pendingTextures);
+        }
 
         render(window, &wp, &cam, &gs);
     }
@@ -601,15 +1057,19 @@ int main() {
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
-    glDeleteTextures(1, &(gs.numberTexture));
-    for (int i = 0; i < gameItemCount;i++) {
-        glDeleteTextures(1, &(gs.gameItems[i].texture));
-        glDeleteBuffers(1, &(gs.gameItems[i].EBO));
-        glDeleteBuffers(1, &(gs.gameItems[i].VBO));
-        glDeleteVertexArrays(1, &(gs.gameItems[i].VAO));
+    gameItem::releaseTexture(gs.numberTexture);
+    for (int i = 0; i < (int)gs.gameItems.size();i++) {
+        gameItem::releaseTexture(gs.gameItems[i].texture);
+        if (i < gs.baseItemCount) {
+            gs.gameItems[i].destroyMesh();
+        }
     }
 
-    glDeleteProgram(shaderProgram);
+    gs.indirect.destroy();
+    gs.instancing.destroy();
+    gs.frameUniforms.destroy();
+    gs.sceneShaders.destroy();
+    gs.markerShaders.destroy();
     glfwTerminate();
     return 0;
 }
@@ -0,0 +1,33 @@
+#version 330 core
+//VERTEX_INDICES : the glyph of the vertex index instead of a plain marker
+//BACK_SIDE_EDGES : the markers are drawn over the faces
+
+flat in vec2 cellPos;
+flat in vec4 markerColor;
+
+layout (std140) uniform frameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 camPos;
+    float ratio;
+    float time;
+    float normalSize;
+    int showNormals;
+    int showVertexIndices;
+    int showVertices;
+    int showBackSideEdges;
+};
+uniform sampler2D numbersTexture;
+void main(){
+
+#ifdef VERTEX_INDICES
+    //gl_PointCoord goes from the top left corner of the sprite, like the rows of numbers.png
+    float cellSize = 0.10;
+    gl_FragColor = texture(numbersTexture,cellSize*(gl_PointCoord + cellPos));
+#else
+    gl_FragColor = markerColor*0.7;
+#endif
+#ifdef BACK_SIDE_EDGES
+    gl_FragDepth = 0.00;
+#endif
+}
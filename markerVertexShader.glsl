@@ -0,0 +1,35 @@
+#version 330 core
+layout (location = 0) in vec3 pos;
+//per instance attributes, only read when instanced == 1
+layout (location = 2) in mat4 instanceModelMatrix;
+layout (location = 6) in vec4 instanceEdgesColor;
+
+flat out vec2 cellPos;
+flat out vec4 markerColor;
+
+layout (std140) uniform frameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 camPos;
+    float ratio;
+    float time;
+    float normalSize;
+    int showNormals;
+    int showVertexIndices;
+    int showVertices;
+    int showBackSideEdges;
+};
+uniform mat4 modelMatrix;
+uniform vec4 itemEdgesColor;
+uniform int instanced;
+uniform float pointSize;    // in pixels, the sprite keeps the same size on screen at any distance
+void main()
+{
+    //drawn with glDrawArrays over the mesh VBO, so gl_VertexID is the vertex index
+    int id = gl_VertexID;
+    cellPos = vec2(float(id%10),float(id/10));
+    mat4 model = instanced == 1 ? instanceModelMatrix : modelMatrix;
+    markerColor = instanced == 1 ? instanceEdgesColor : itemEdgesColor;
+    gl_Position = projMatrix*viewMatrix*model*vec4(pos, 1.0);
+    gl_PointSize = pointSize;
+}
@@ -0,0 +1,267 @@
+#include "meshBvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+//subtrees smaller than this are not worth a thread
+#define MESH_BVH_THREAD_MIN_TRIANGLES 65536
+
+meshBvh::meshBvh() :
+    buildSeconds(0.),
+    vertices(NULL),
+    vertexSize(0),
+    indices(NULL) {
+}
+
+glm::vec3 meshBvh::getCorner(unsigned int triangle, int corner) {
+    const float* p = this->vertices + (size_t)this->indices[3 * triangle + corner] * this->vertexSize;
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+static float getSurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    glm::vec3 d = boundsMax - boundsMin;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+void meshBvh::build(const float* vertices, unsigned int vertexSize, const unsigned int* indices, unsigned int indexCount, unsigned int threadCount) {
+    auto start = chrono::steady_clock::now();
+    this->vertices = vertices;
+    this->vertexSize = vertexSize;
+    this->indices = indices;
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    unsigned int triangleCount = indexCount / 3;
+    this->triangles.resize(triangleCount);
+    this->triangleMin.resize(triangleCount);
+    this->triangleMax.resize(triangleCount);
+    this->triangleCentroids.resize(triangleCount);
+
+    //bounds of every triangle, split between the threads
+    vector<thread> workers;
+    unsigned int slice = (triangleCount + threadCount - 1) / threadCount;
+    for (unsigned int t = 0; t < threadCount; t++) {
+        unsigned int begin = min(triangleCount, t * slice), end = min(triangleCount, begin + slice);
+        workers.push_back(thread([this, begin, end]() {
+            for (unsigned int i = begin; i < end; i++) {
+                glm::vec3 a = this->getCorner(i, 0), b = this->getCorner(i, 1), c = this->getCorner(i, 2);
+                this->triangles[i] = i;
+                this->triangleMin[i] = glm::min(a, glm::min(b, c));
+                this->triangleMax[i] = glm::max(a, glm::max(b, c));
+                this->triangleCentroids[i] = (a + b + c) * (1.f / 3.f);
+            }
+        }));
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    this->nodes.clear();
+    this->nodes.reserve(2 * triangleCount);
+    if (triangleCount > 0) {
+        this->buildNode(&this->nodes, 0, triangleCount, threadCount - 1);
+    }
+    //only needed while building
+    vector<glm::vec3>().swap(this->triangleMin);
+    vector<glm::vec3>().swap(this->triangleMax);
+    vector<glm::vec3>().swap(this->triangleCentroids);
+    this->buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool meshBvh::isBuilt() {
+    return !this->nodes.empty();
+}
+
+void meshBvh::buildNode(vector<meshBvhNode>* nodes, unsigned int first, unsigned int count, int spareThreads) {
+    glm::vec3 boundsMin = glm::vec3(FLT_MAX), boundsMax = glm::vec3(-FLT_MAX);
+    glm::vec3 centroidMin = glm::vec3(FLT_MAX), centroidMax = glm::vec3(-FLT_MAX);
+    for (unsigned int i = first; i < first + count; i++) {
+        unsigned int triangle = this->triangles[i];
+        boundsMin = glm::min(boundsMin, this->triangleMin[triangle]);
+        boundsMax = glm::max(boundsMax, this->triangleMax[triangle]);
+        centroidMin = glm::min(centroidMin, this->triangleCentroids[triangle]);
+        centroidMax = glm::max(centroidMax, this->triangleCentroids[triangle]);
+    }
+    unsigned int node = nodes->size();
+    meshBvhNode leaf;
+    leaf.boundsMin = boundsMin;
+    leaf.boundsMax = boundsMax;
+    leaf.rightChild = first;
+    leaf.triangleCount = count;
+    nodes->push_back(leaf);
+    if (count == 1) {
+        return;
+    }
+
+    //binned surface area heuristic along the longest centroid axis, cost of a split = 1 traversal + expected number of triangle tests
+    int bestAxis = -1, bestSplit = 0;
+    float bestCost = FLT_MAX;
+    float parentArea = max(getSurfaceArea(boundsMin, boundsMax), FLT_MIN);
+    glm::vec3 centroidExtent = centroidMax - centroidMin;
+    int axis = centroidExtent.x > centroidExtent.y ? (centroidExtent.x > centroidExtent.z ? 0 : 2) : (centroidExtent.y > centroidExtent.z ? 1 : 2);
+    float extent = centroidExtent[axis];
+    if (extent > 0.f) {
+        unsigned int binCounts[MESH_BVH_BINS] = { 0 };
+        glm::vec3 binsMin[MESH_BVH_BINS], binsMax[MESH_BVH_BINS];
+        for (int b = 0; b < MESH_BVH_BINS; b++) {
+            binsMin[b] = glm::vec3(FLT_MAX);
+            binsMax[b] = glm::vec3(-FLT_MAX);
+        }
+        float scale = MESH_BVH_BINS / extent;
+        for (unsigned int i = first; i < first + count; i++) {
+            unsigned int triangle = this->triangles[i];
+            int b = min(MESH_BVH_BINS - 1, (int)((this->triangleCentroids[triangle][axis] - centroidMin[axis]) * scale));
+            binCounts[b]++;
+            binsMin[b] = glm::min(binsMin[b], this->triangleMin[triangle]);
+            binsMax[b] = glm::max(binsMax[b], this->triangleMax[triangle]);
+        }
+        //areas and counts left of each split plane, then swept from the right
+        float leftAreas[MESH_BVH_BINS - 1];
+        unsigned int leftCounts[MESH_BVH_BINS - 1];
+        glm::vec3 sweepMin = glm::vec3(FLT_MAX), sweepMax = glm::vec3(-FLT_MAX);
+        unsigned int sweepCount = 0;
+        for (int b = 0; b < MESH_BVH_BINS - 1; b++) {
+            sweepCount += binCounts[b];
+            sweepMin = glm::min(sweepMin, binsMin[b]);
+            sweepMax = glm::max(sweepMax, binsMax[b]);
+            leftCounts[b] = sweepCount;
+            leftAreas[b] = sweepCount ? getSurfaceArea(sweepMin, sweepMax) : 0.f;
+        }
+        sweepMin = glm::vec3(FLT_MAX);
+        sweepMax = glm::vec3(-FLT_MAX);
+        sweepCount = 0;
+        for (int b = MESH_BVH_BINS - 1; b > 0; b--) {
+            sweepCount += binCounts[b];
+            sweepMin = glm::min(sweepMin, binsMin[b]);
+            sweepMax = glm::max(sweepMax, binsMax[b]);
+            if (sweepCount == 0 || leftCounts[b - 1] == 0) {
+                continue;
+            }
+            float cost = 1.f + (leftAreas[b - 1] * leftCounts[b - 1] + getSurfaceArea(sweepMin, sweepMax) * sweepCount) / parentArea;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b;
+            }
+        }
+    }
+
+    unsigned int leftCount;
+    if (bestAxis == -1) {
+        //all centroids at the same place, the triangles are just cut in two when there are too many of them
+        if (count <= MESH_BVH_MAX_LEAF_SIZE) {
+            return;
+        }
+        leftCount = count / 2;
+    }
+    else {
+        if (count <= MESH_BVH_MAX_LEAF_SIZE && bestCost >= count) {
+            return;
+        }
+        float scale = MESH_BVH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+        float origin = centroidMin[bestAxis];
+        const glm::vec3* centroids = this->triangleCentroids.data();
+        auto middle = partition(this->triangles.begin() + first, this->triangles.begin() + first + count, [&](unsigned int triangle) {
+            return min(MESH_BVH_BINS - 1, (int)((centroids[triangle][bestAxis] - origin) * scale)) < bestSplit;
+        });
+        leftCount = middle - (this->triangles.begin() + first);
+    }
+
+    (*nodes)[node].triangleCount = 0;
+    if (spareThreads > 0 && count >= MESH_BVH_THREAD_MIN_TRIANGLES) {
+        //the right subtree is built by another thread in its own node list, then appended
+        int rightSpareThreads = (spareThreads - 1) / 2;
+        vector<meshBvhNode> rightNodes;
+        thread rightWorker([&]() {
+            this->buildNode(&rightNodes, first + leftCount, count - leftCount, rightSpareThreads);
+        });
+        this->buildNode(nodes, first, leftCount, spareThreads - 1 - rightSpareThreads);
+        rightWorker.join();
+        unsigned int offset = nodes->size();
+        (*nodes)[node].rightChild = offset;
+        for (meshBvhNode& n : rightNodes) {
+            if (n.triangleCount == 0) {
+                n.rightChild += offset;
+            }
+        }
+        nodes->insert(nodes->end(), rightNodes.begin(), rightNodes.end());
+    }
+    else {
+        this->buildNode(nodes, first, leftCount, 0);
+        (*nodes)[node].rightChild = nodes->size();
+        this->buildNode(nodes, first + leftCount, count - leftCount, 0);
+    }
+}
+
+//slab test, true if the box is entered before maxDistance
+static bool hitsBox(const glm::vec3& origin, const glm::vec3& inverseDirection, const meshBvhNode& node, float maxDistance) {
+    glm::vec3 t0 = (node.boundsMin - origin) * inverseDirection;
+    glm::vec3 t1 = (node.boundsMax - origin) * inverseDirection;
+    glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+    float entry = max(max(tNear.x, tNear.y), max(tNear.z, 0.f));
+    float exit = min(min(tFar.x, tFar.y), min(tFar.z, maxDistance));
+    return entry <= exit;
+}
+
+bool meshBvh::intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, meshRayHit* hit) {
+    if (this->nodes.empty()) {
+        return false;
+    }
+    bool found = false;
+    glm::vec3 inverseDirection = 1.f / direction;
+    this->stack.clear();
+    this->stack.push_back(0);
+    while (!this->stack.empty()) {
+        unsigned int index = this->stack.back();
+        this->stack.pop_back();
+        const meshBvhNode& node = this->nodes[index];
+        //tested when popped, maxDistance may have shrunk since the node was pushed
+        if (!hitsBox(origin, inverseDirection, node, maxDistance)) {
+            continue;
+        }
+        if (node.triangleCount == 0) {
+            //the child nearest along the ray is visited first
+            unsigned int left = index + 1, right = node.rightChild;
+            int axis = fabs(direction.x) > fabs(direction.y) ? (fabs(direction.x) > fabs(direction.z) ? 0 : 2) : (fabs(direction.y) > fabs(direction.z) ? 1 : 2);
+            bool leftFirst = (this->nodes[left].boundsMin[axis] + this->nodes[left].boundsMax[axis] < this->nodes[right].boundsMin[axis] + this->nodes[right].boundsMax[axis]) == (direction[axis] > 0.f);
+            this->stack.push_back(leftFirst ? right : left);
+            this->stack.push_back(leftFirst ? left : right);
+            continue;
+        }
+        //Moller-Trumbore
+        for (unsigned int i = node.rightChild; i < node.rightChild + node.triangleCount; i++) {
+            unsigned int triangle = this->triangles[i];
+            glm::vec3 a = this->getCorner(triangle, 0), b = this->getCorner(triangle, 1), c = this->getCorner(triangle, 2);
+            glm::vec3 edge1 = b - a, edge2 = c - a;
+            glm::vec3 p = glm::cross(direction, edge2);
+            float determinant = glm::dot(edge1, p);
+            if (fabs(determinant) < 1e-12f) {
+                continue;
+            }
+            float inverseDeterminant = 1.f / determinant;
+            glm::vec3 s = origin - a;
+            float u = glm::dot(s, p) * inverseDeterminant;
+            if (u < 0.f || u > 1.f) {
+                continue;
+            }
+            glm::vec3 q = glm::cross(s, edge1);
+            float v = glm::dot(direction, q) * inverseDeterminant;
+            if (v < 0.f || u + v > 1.f) {
+                continue;
+            }
+            float distance = glm::dot(edge2, q) * inverseDeterminant;
+            if (distance > 0.f && distance < maxDistance) {
+                maxDistance = distance;
+                hit->triangle = triangle;
+                hit->distance = distance;
+                hit->u = u;
+                hit->v = v;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+using namespace std;
+
+#define MESH_BVH_BINS 16
+#define MESH_BVH_MAX_LEAF_SIZE 8
+
+struct meshBvhNode {
+    glm::vec3 boundsMin;
+    unsigned int rightChild;        // the left child is the next node, first triangle for a leaf
+    glm::vec3 boundsMax;
+    unsigned int triangleCount;     // 0 for an internal node
+}typedef meshBvhNode;
+
+struct meshRayHit {
+    unsigned int triangle;  // index of the triangle in the index buffer (its corners are indices[3 * triangle + 0..2])
+    float distance;         // in units of the ray direction
+    float u;                // barycentrics of the hit, weights of the corners are (1 - u - v, u, v)
+    float v;
+}typedef meshRayHit;
+
+//SAH bounding volume hierarchy over the triangles of one mesh, in model space
+//the mesh arrays are not copied and must outlive the bvh
+class meshBvh {
+public:
+    vector<meshBvhNode> nodes;
+    vector<unsigned int> triangles;     // triangle indices in leaf order
+    double buildSeconds;
+    meshBvh();
+    //vertexSize is the number of floats per vertex, positions are its first three; threadCount 0 means one per core
+    void build(const float* vertices, unsigned int vertexSize, const unsigned int* indices, unsigned int indexCount, unsigned int threadCount = 0);
+    bool isBuilt();
+    //nearest triangle hit by the ray closer than maxDistance
+    bool intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, meshRayHit* hit);
+private:
+    const float* vertices;
+    unsigned int vertexSize;
+    const unsigned int* indices;
+    vector<glm::vec3> triangleMin;
+    vector<glm::vec3> triangleMax;
+    vector<glm::vec3> triangleCentroids;
+    vector<unsigned int> stack;
+    glm::vec3 getCorner(unsigned int triangle, int corner);
+    //builds the subtree of triangles[first, first + count) into nodes, spawning threads for big subtrees while spareThreads > 0
+    void buildNode(vector<meshBvhNode>* nodes, unsigned int first, unsigned int count, int spareThreads);
+};
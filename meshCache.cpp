@@ -0,0 +1,150 @@
+#include "meshCache.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static int64_t getModificationTime(const struct stat* fileStat) {
+    return (int64_t)fileStat->st_mtim.tv_sec * 1000000000 + fileStat->st_mtim.tv_nsec;
+}
+
+static uint64_t hashBytes(const unsigned char* bytes, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+string getMeshCacheFileName(const char* sourceFileName) {
+    string cacheFileName = sourceFileName;
+    cacheFileName += ".mesh";
+    return cacheFileName;
+}
+
+uint64_t hashFile(const char* fileName) {
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat fileStat;
+    uint64_t hash = hashBytes(NULL, 0);
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+        void* mapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            hash = hashBytes((const unsigned char*)mapping, fileStat.st_size);
+            munmap(mapping, fileStat.st_size);
+        }
+    }
+    close(fd);
+    return hash;
+}
+
+bool openMeshCache(const char* sourceFileName, meshCacheMapping* cache) {
+    struct stat sourceStat;
+    if (stat(sourceFileName, &sourceStat) != 0) {
+        return false;
+    }
+    string cacheFileName = getMeshCacheFileName(sourceFileName);
+    int fd = open(cacheFileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat cacheStat;
+    if (fstat(fd, &cacheStat) != 0 || (size_t)cacheStat.st_size < sizeof(meshCacheHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = cacheStat.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    const meshCacheHeader* header = (const meshCacheHeader*)mapping;
+    bool valid = memcmp(header->magic, "MESH", 4) == 0
+        && header->version == MESH_CACHE_VERSION
+        && header->sourceSize == (uint64_t)sourceStat.st_size
+        && size == sizeof(meshCacheHeader) + ((size_t)header->vertexCount + header->normalCount) * sizeof(float) + ((size_t)header->indexCount + header->splitSourceCount) * sizeof(unsigned int);
+    if (valid && header->sourceModificationTime != getModificationTime(&sourceStat)) {
+        //the source was touched, it is only stale if its content changed
+        valid = header->sourceHash == hashFile(sourceFileName);
+        if (valid) {
+            //best effort, saves the hash next time, a cache in a read only location is still used
+            int writeFd = open(cacheFileName.c_str(), O_WRONLY);
+            if (writeFd >= 0) {
+                meshCacheHeader updatedHeader = *header;
+                updatedHeader.sourceModificationTime = getModificationTime(&sourceStat);
+                if (pwrite(writeFd, &updatedHeader, sizeof(updatedHeader), 0) != sizeof(updatedHeader)) {
+                    printf("Failed to update mesh cache header : %s\n", cacheFileName.c_str());
+                }
+                close(writeFd);
+            }
+        }
+    }
+    close(fd);
+    if (!valid) {
+        munmap(mapping, size);
+        return false;
+    }
+    madvise(mapping, size, MADV_WILLNEED);
+    cache->mapping = mapping;
+    cache->size = size;
+    cache->vertexCount = header->vertexCount;
+    cache->indexCount = header->indexCount;
+    cache->vertices = (float*)((char*)mapping + sizeof(meshCacheHeader));
+    cache->indices = (unsigned int*)(cache->vertices + header->vertexCount);
+    cache->normalCount = header->normalCount;
+    cache->normals = (float*)(cache->indices + header->indexCount);
+    cache->splitSourceCount = header->splitSourceCount;
+    cache->splitSources = (unsigned int*)(cache->normals + header->normalCount);
+    return true;
+}
+
+void closeMeshCache(meshCacheMapping* cache) {
+    if (cache->mapping) {
+        munmap(cache->mapping, cache->size);
+    }
+    *cache = meshCacheMapping();
+}
+
+bool writeMeshCache(const char* sourceFileName, const float* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount,
+    const float* normals, unsigned int normalCount, const unsigned int* splitSources, unsigned int splitSourceCount) {
+    struct stat sourceStat;
+    if (stat(sourceFileName, &sourceStat) != 0) {
+        return false;
+    }
+    meshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "MESH", 4);
+    header.version = MESH_CACHE_VERSION;
+    header.sourceModificationTime = getModificationTime(&sourceStat);
+    header.sourceSize = sourceStat.st_size;
+    header.sourceHash = hashFile(sourceFileName);
+    header.vertexCount = vertexCount;
+    header.indexCount = indexCount;
+    header.normalCount = normalCount;
+    header.splitSourceCount = splitSourceCount;
+
+    //written next to the final file then renamed, a crash never leaves a truncated cache behind
+    string cacheFileName = getMeshCacheFileName(sourceFileName);
+    string temporaryFileName = cacheFileName + ".tmp";
+    FILE* file = fopen(temporaryFileName.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(vertices, sizeof(float), vertexCount, file) == vertexCount
+        && fwrite(indices, sizeof(unsigned int), indexCount, file) == indexCount
+        && fwrite(normals, sizeof(float), normalCount, file) == normalCount
+        && fwrite(splitSources, sizeof(unsigned int), splitSourceCount, file) == splitSourceCount;
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporaryFileName.c_str(), cacheFileName.c_str()) != 0) {
+        remove(temporaryFileName.c_str());
+        return false;
+    }
+    return true;
+}
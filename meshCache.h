@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+#define MESH_CACHE_VERSION 3
+
+//.mesh file : this header followed by the vertex, index and normal buffers exactly as gameItem::loadMesh uploads them,
+//then the source vertex of each hard edge copy (the copies are the last splitSourceCount vertices)
+struct meshCacheHeader {
+    char magic[4];                  // "MESH"
+    uint32_t version;
+    int64_t sourceModificationTime; // nanoseconds
+    uint64_t sourceSize;
+    uint64_t sourceHash;            // FNV-1a of the source file
+    uint32_t vertexCount;           // number of floats, like gameItem::vertexCount
+    uint32_t indexCount;
+    uint32_t normalCount;           // number of floats, NORMAL_SIZE per vertex
+    uint32_t splitSourceCount;
+}typedef meshCacheHeader;
+
+//a validated .mesh file mapped in memory, the pointers stay valid as long as the mapping is alive
+struct meshCacheMapping {
+    void* mapping;
+    size_t size;
+    float* vertices;
+    unsigned int vertexCount;
+    unsigned int* indices;
+    unsigned int indexCount;
+    float* normals;
+    unsigned int normalCount;
+    unsigned int* splitSources;
+    unsigned int splitSourceCount;
+    meshCacheMapping() : mapping(NULL), size(0), vertices(NULL), vertexCount(0), indices(NULL), indexCount(0), normals(NULL), normalCount(0),
+        splitSources(NULL), splitSourceCount(0) {}
+}typedef meshCacheMapping;
+
+string getMeshCacheFileName(const char* sourceFileName);
+uint64_t hashFile(const char* fileName);
+
+//maps the cache of sourceFileName, fails if it is missing, from another version or if the source changed
+bool openMeshCache(const char* sourceFileName, meshCacheMapping* cache);
+void closeMeshCache(meshCacheMapping* cache);
+bool writeMeshCache(const char* sourceFileName, const float* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount,
+    const float* normals, unsigned int normalCount, const unsigned int* splitSources, unsigned int splitSourceCount);
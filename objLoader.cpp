@@ -0,0 +1,480 @@
+#include "objLoader.h"
+
+#include <cstdio>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const double powersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+static inline bool isDigit(char c) {
+    return (unsigned char)(c - '0') < 10;
+}
+static inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) p++;
+    return p;
+}
+static inline const char* skipLine(const char* p, const char* end) {
+    while (p < end && *p != '\n') p++;
+    return p < end ? p + 1 : end;
+}
+
+//no locale, no allocation : sign, digits, fraction and exponent
+static const char* parseFloat(const char* p, const char* end, float* out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    while (p < end && isDigit(*p)) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        else {
+            exponent++;
+        }
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && isDigit(*p)) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+            p++;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        int e = 0;
+        while (p < end && isDigit(*p)) {
+            if (e < 10000) e = e * 10 + (*p - '0');
+            p++;
+        }
+        exponent += negativeExponent ? -e : e;
+    }
+    double value = (double)mantissa;
+    if (exponent < 0) {
+        value = exponent >= -22 ? value / powersOf10[-exponent] : value * pow(10., exponent);
+    }
+    else if (exponent > 0) {
+        value = exponent <= 22 ? value * powersOf10[exponent] : value * pow(10., exponent);
+    }
+    *out = (float)(negative ? -value : value);
+    return p;
+}
+
+static const char* parseInt(const char* p, const char* end, int* out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    int value = 0;
+    while (p < end && isDigit(*p)) {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    *out = negative ? -value : value;
+    return p;
+}
+
+//obj indices are 1-based, negative ones are relative to the current end of the list
+static inline int resolveIndex(int index, int count) {
+    if (index > 0) return index - 1;
+    if (index < 0) return count + index;
+    return -1;
+}
+
+static const char* parseFloats(const char* p, const char* end, int count, vector<float>* out) {
+    for (int i = 0; i < count; i++) {
+        float value = 0.f;
+        p = skipBlanks(p, end);
+        p = parseFloat(p, end, &value);
+        out->push_back(value);
+    }
+    return p;
+}
+
+//relativeSlots (optional) receives the faceIndices slots that were resolved from negative indices,
+//a chunk parsed on its own resolves them against its local counts and they are offset when merging
+static inline void emitCorner(const int* corner, int relativeMask, objData* data, vector<size_t>* relativeSlots) {
+    if (relativeMask && relativeSlots) {
+        for (int i = 0; i < 3; i++) {
+            if (relativeMask & (1 << i)) relativeSlots->push_back(data->faceIndices.size() + i);
+        }
+    }
+    data->faceIndices.insert(data->faceIndices.end(), corner, corner + 3);
+}
+
+static const char* parseFace(const char* p, const char* end, objData* data, vector<size_t>* relativeSlots) {
+    int positionCount = data->positions.size() / 3;
+    int texCoordCount = data->texCoords.size() / 2;
+    int normalCount = data->normals.size() / 3;
+    int first[3], firstMask = 0;
+    int previous[3], previousMask = 0;
+    int cornerCount = 0;
+    while (true) {
+        p = skipBlanks(p, end);
+        if (p >= end || !(isDigit(*p) || *p == '-' || *p == '+')) break;
+        int corner[3] = { 0, 0, 0 };
+        p = parseInt(p, end, &corner[0]);
+        if (p < end && *p == '/') {
+            p++;
+            if (p < end && *p != '/') p = parseInt(p, end, &corner[1]);
+            if (p < end && *p == '/') {
+                p++;
+                p = parseInt(p, end, &corner[2]);
+            }
+        }
+        int mask = (corner[0] < 0) | (corner[1] < 0) << 1 | (corner[2] < 0) << 2;
+        corner[0] = resolveIndex(corner[0], positionCount);
+        corner[1] = resolveIndex(corner[1], texCoordCount);
+        corner[2] = resolveIndex(corner[2], normalCount);
+
+        //fan triangulation : (first, previous, current)
+        if (cornerCount >= 2) {
+            emitCorner(first, firstMask, data, relativeSlots);
+            emitCorner(previous, previousMask, data, relativeSlots);
+            emitCorner(corner, mask, data, relativeSlots);
+        }
+        if (cornerCount == 0) {
+            first[0] = corner[0]; first[1] = corner[1]; first[2] = corner[2];
+            firstMask = mask;
+        }
+        previous[0] = corner[0]; previous[1] = corner[1]; previous[2] = corner[2];
+        previousMask = mask;
+        cornerCount++;
+    }
+    return p;
+}
+
+static void parseObjRange(const char* begin, const char* end, objData* data, vector<size_t>* relativeSlots) {
+    const char* p = begin;
+    while (p < end) {
+        p = skipBlanks(p, end);
+        if (p + 1 < end && p[0] == 'v') {
+            if (isBlank(p[1])) {
+                p = parseFloats(p + 2, end, 3, &data->positions);
+            }
+            else if (p[1] == 't' && p + 2 < end && isBlank(p[2])) {
+                p = parseFloats(p + 3, end, 2, &data->texCoords);
+            }
+            else if (p[1] == 'n' && p + 2 < end && isBlank(p[2])) {
+                p = parseFloats(p + 3, end, 3, &data->normals);
+            }
+        }
+        else if (p + 1 < end && p[0] == 'f' && isBlank(p[1])) {
+            p = parseFace(p + 2, end, data, relativeSlots);
+        }
+        p = skipLine(p, end);
+    }
+}
+
+void parseObj(const char* begin, const char* end, objData* data) {
+    parseObjRange(begin, end, data, NULL);
+}
+bool loadObjFile(const char* fileName, objData* data) {
+    FILE* file = fopen(fileName, "rb");
+    if (!file) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    vector<char> bytes(size > 0 ? size : 0);
+    size_t readSize = fread(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+    if (readSize != bytes.size()) {
+        return false;
+    }
+    //a v line takes at least ~20 bytes, reserving avoids most of the regrowth on big files
+    data->positions.reserve(bytes.size() / 20);
+    data->faceIndices.reserve(bytes.size() / 4);
+    parseObj(bytes.data(), bytes.data() + bytes.size(), data);
+    return true;
+}
+
+struct objChunk {
+    const char* begin;
+    const char* end;
+    objData data;
+    vector<size_t> relativeSlots;
+    size_t positionOffset;  // in floats, where the chunk lands in the merged streams
+    size_t texCoordOffset;
+    size_t normalOffset;
+    size_t faceOffset;
+}typedef objChunk;
+
+void parseObjParallel(const char* begin, const char* end, objData* data, unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    //below a few MB the thread start up costs more than it saves
+    size_t minChunkSize = 1 << 20;
+    size_t size = end - begin;
+    threadCount = min<size_t>(threadCount, max<size_t>(1, size / minChunkSize));
+    if (threadCount == 1) {
+        parseObj(begin, end, data);
+        return;
+    }
+
+    //split on line boundaries
+    vector<objChunk> chunks(threadCount);
+    const char* chunkBegin = begin;
+    for (unsigned int i = 0; i < threadCount; i++) {
+        const char* chunkEnd = i + 1 == threadCount ? end : begin + size * (i + 1) / threadCount;
+        if (chunkEnd < chunkBegin) chunkEnd = chunkBegin;
+        const char* newLine = (const char*)memchr(chunkEnd, '\n', end - chunkEnd);
+        chunkEnd = newLine ? newLine + 1 : end;
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    vector<thread> threads;
+    for (unsigned int i = 0; i < threadCount; i++) {
+        threads.push_back(thread([&chunks, i]() {
+            objChunk* chunk = &chunks[i];
+            size_t chunkSize = chunk->end - chunk->begin;
+            chunk->data.positions.reserve(chunkSize / 20);
+            chunk->data.faceIndices.reserve(chunkSize / 4);
+            parseObjRange(chunk->begin, chunk->end, &chunk->data, &chunk->relativeSlots);
+        }));
+    }
+    for (thread& t : threads) t.join();
+    threads.clear();
+
+    //each chunk starts where the previous ones end in the merged streams
+    size_t positionCount = 0, texCoordCount = 0, normalCount = 0, faceCount = 0;
+    for (objChunk& chunk : chunks) {
+        chunk.positionOffset = positionCount;
+        chunk.texCoordOffset = texCoordCount;
+        chunk.normalOffset = normalCount;
+        chunk.faceOffset = faceCount;
+        positionCount += chunk.data.positions.size();
+        texCoordCount += chunk.data.texCoords.size();
+        normalCount += chunk.data.normals.size();
+        faceCount += chunk.data.faceIndices.size();
+    }
+    data->positions.resize(positionCount);
+    data->texCoords.resize(texCoordCount);
+    data->normals.resize(normalCount);
+    data->faceIndices.resize(faceCount);
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        threads.push_back(thread([&chunks, data, i]() {
+            objChunk* chunk = &chunks[i];
+            objData* local = &chunk->data;
+            //negative indices were resolved against the chunk's own counts
+            int offsets[3] = { (int)chunk->positionOffset / 3, (int)chunk->texCoordOffset / 2, (int)chunk->normalOffset / 3 };
+            for (size_t slot : chunk->relativeSlots) {
+                local->faceIndices[slot] += offsets[slot % 3];
+            }
+            copy(local->positions.begin(), local->positions.end(), data->positions.begin() + chunk->positionOffset);
+            copy(local->texCoords.begin(), local->texCoords.end(), data->texCoords.begin() + chunk->texCoordOffset);
+            copy(local->normals.begin(), local->normals.end(), data->normals.begin() + chunk->normalOffset);
+            copy(local->faceIndices.begin(), local->faceIndices.end(), data->faceIndices.begin() + chunk->faceOffset);
+            local->clear();
+            local->positions.shrink_to_fit();
+            local->texCoords.shrink_to_fit();
+            local->normals.shrink_to_fit();
+            local->faceIndices.shrink_to_fit();
+        }));
+    }
+    for (thread& t : threads) t.join();
+}
+
+bool loadObjFileParallel(const char* fileName, objData* data, unsigned int threadCount) {
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = fileStat.st_size;
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    madvise(mapping, size, MADV_WILLNEED);
+    const char* bytes = (const char*)mapping;
+    parseObjParallel(bytes, bytes + size, data, threadCount);
+    munmap(mapping, size);
+    return true;
+}
+
+static inline uint32_t hashCorner(const int* corner) {
+    uint32_t h = (uint32_t)corner[0] * 0x9E3779B1u;
+    h ^= (uint32_t)corner[1] * 0x85EBCA77u + (h << 6) + (h >> 2);
+    h ^= (uint32_t)corner[2] * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h;
+}
+
+//one slot of the welding table : the corner key and the vertex it became
+struct weldSlot {
+    int corner[3];
+    unsigned int vertexIndex;
+}typedef weldSlot;
+
+void buildInterleavedMesh(objData* data, vector<float>* vertices, vector<unsigned int>* indices, meshWeldStats* stats, vector<float>* normals,
+    vector<unsigned int>* splitSources) {
+    auto start = chrono::steady_clock::now();
+    unsigned int cornerCount = data->faceIndices.size() / 3;
+    const int* faceIndices = data->faceIndices.data();
+    indices->resize(cornerCount);
+
+    //the normals of the file are only kept when every corner has one, a partial set would mix with computed ones
+    int normalCount = data->normals.size() / 3;
+    bool keepNormals = normals != NULL && cornerCount > 0;
+    for (unsigned int i = 0; i < cornerCount && keepNormals; i++) {
+        keepNormals = faceIndices[3 * i + 2] >= 0 && faceIndices[3 * i + 2] < normalCount;
+    }
+
+    //open addressing with linear probing, kept under half full
+    unsigned int capacity = 16;
+    while (capacity < 2 * cornerCount) capacity *= 2;
+    unsigned int mask = capacity - 1;
+    const unsigned int emptySlot = 0xFFFFFFFFu;
+    vector<weldSlot> table(capacity);
+    for (weldSlot& slot : table) slot.vertexIndex = emptySlot;
+
+    vector<unsigned int> firstCorners;  // for each vertex, the first corner that produced it
+    firstCorners.reserve(cornerCount / 2);
+    for (unsigned int i = 0; i < cornerCount; i++) {
+        //vn is left out of the key, corners that only differ by it are split afterwards so the v/vt numbering does not depend on it
+        int corner[3] = { faceIndices[3 * i], faceIndices[3 * i + 1], -1 };
+        unsigned int slot = hashCorner(corner) & mask;
+        while (true) {
+            weldSlot* entry = &table[slot];
+            if (entry->vertexIndex == emptySlot) {
+                entry->corner[0] = corner[0];
+                entry->corner[1] = corner[1];
+                entry->corner[2] = corner[2];
+                entry->vertexIndex = firstCorners.size();
+                firstCorners.push_back(i);
+                (*indices)[i] = entry->vertexIndex;
+                break;
+            }
+            if (entry->corner[0] == corner[0] && entry->corner[1] == corner[1] && entry->corner[2] == corner[2]) {
+                (*indices)[i] = entry->vertexIndex;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+    table.clear();
+    table.shrink_to_fit();
+
+    unsigned int vertexCount = firstCorners.size();
+    vertices->resize(vertexCount * 5);
+    float* v = vertices->data();
+    int positionCount = data->positions.size() / 3;
+    int texCoordCount = data->texCoords.size() / 2;
+    for (unsigned int i = 0; i < vertexCount; i++) {
+        int positionIndex = faceIndices[3 * firstCorners[i]];
+        int texCoordIndex = faceIndices[3 * firstCorners[i] + 1];
+        if (positionIndex >= 0 && positionIndex < positionCount) {
+            v[0] = data->positions[3 * positionIndex];
+            v[1] = data->positions[3 * positionIndex + 1];
+            v[2] = data->positions[3 * positionIndex + 2];
+        }
+        else {
+            v[0] = v[1] = v[2] = 0.f;
+        }
+        if (texCoordIndex >= 0 && texCoordIndex < texCoordCount) {
+            //obj texture space has its origin at the bottom left, stb_image loads images top to bottom
+            v[3] = data->texCoords[2 * texCoordIndex];
+            v[4] = 1.f - data->texCoords[2 * texCoordIndex + 1];
+        }
+        else {
+            v[3] = v[4] = 0.f;
+        }
+        v += 5;
+    }
+    if (normals) {
+        normals->clear();
+    }
+    if (splitSources) {
+        splitSources->clear();
+    }
+    if (keepNormals) {
+        //a vertex whose corners have different vn gets one copy per vn, appended after the welded vertices
+        const unsigned int noCopy = 0xFFFFFFFFu;
+        vector<int> vertexNormals(vertexCount);
+        vector<unsigned int> nextCopies(vertexCount, noCopy);
+        for (unsigned int i = 0; i < vertexCount; i++) {
+            vertexNormals[i] = faceIndices[3 * firstCorners[i] + 2];
+        }
+        for (unsigned int i = 0; i < cornerCount; i++) {
+            int normalIndex = faceIndices[3 * i + 2];
+            unsigned int vertex = (*indices)[i];
+            unsigned int lastCopy = vertex;
+            while (vertex != noCopy && vertexNormals[vertex] != normalIndex) {
+                lastCopy = vertex;
+                vertex = nextCopies[vertex];
+            }
+            if (vertex == noCopy) {
+                vertex = vertexNormals.size();
+                unsigned int source = (*indices)[i];
+                float copiedVertex[5];
+                copy(vertices->begin() + (size_t)source * 5, vertices->begin() + (size_t)source * 5 + 5, copiedVertex);
+                vertices->insert(vertices->end(), copiedVertex, copiedVertex + 5);
+                vertexNormals.push_back(normalIndex);
+                nextCopies.push_back(noCopy);
+                nextCopies[lastCopy] = vertex;
+                if (splitSources) splitSources->push_back(source);
+            }
+            (*indices)[i] = vertex;
+        }
+        normals->resize(vertexNormals.size() * 3);
+        float* n = normals->data();
+        for (int normalIndex : vertexNormals) {
+            n[0] = data->normals[3 * normalIndex];
+            n[1] = data->normals[3 * normalIndex + 1];
+            n[2] = data->normals[3 * normalIndex + 2];
+            n += 3;
+        }
+    }
+
+    if (stats) {
+        stats->cornerCount = cornerCount;
+        stats->vertexCount = vertexCount;
+        stats->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+//raw content of an .obj file, faces are fan triangulated while parsing
+struct objData {
+    vector<float> positions;    // x y z
+    vector<float> texCoords;    // u v
+    vector<float> normals;      // x y z
+    vector<int> faceIndices;    // v vt vn for each triangle corner, 0-based, -1 when absent
+    unsigned int getTriangleCount() {
+        return this->faceIndices.size() / 9;
+    }
+    void clear() {
+        positions.clear();
+        texCoords.clear();
+        normals.clear();
+        faceIndices.clear();
+    }
+}typedef objData;
+
+//single pass parser over the bytes of an .obj file (only v, vt, vn and f are read)
+void parseObj(const char* begin, const char* end, objData* data);
+bool loadObjFile(const char* fileName, objData* data);
+
+//same result as parseObj, the bytes are split on line boundaries and parsed by threadCount threads (0 = one per core)
+void parseObjParallel(const char* begin, const char* end, objData* data, unsigned int threadCount = 0);
+//memory maps the file and parses it with parseObjParallel
+bool loadObjFileParallel(const char* fileName, objData* data, unsigned int threadCount = 0);
+
+struct meshWeldStats {
+    unsigned int cornerCount;   // vertices before welding (3 per triangle)
+    unsigned int vertexCount;   // unique v/vt pairs, before the copies split for the normals
+    double seconds;
+    float getDedupRatio() {
+        return this->vertexCount == 0 ? 1.f : (float)this->cornerCount / (float)this->vertexCount;
+    }
+}typedef meshWeldStats;
+
+//builds the interleaved layout used by gameItem::loadMesh (x y z u v), each unique v/vt pair becomes one vertex
+//with normals, the vn of the file are kept (x y z per vertex) when every corner has one, normals is left empty otherwise
+//a v/vt vertex used with several vn (a hard edge) gets one copy per extra vn appended after the welded vertices, so these keep
+//the same numbering as without normals, splitSources gives the welded vertex each copy comes from
+void buildInterleavedMesh(objData* data, vector<float>* vertices, vector<unsigned int>* indices, meshWeldStats* stats = NULL, vector<float>* normals = NULL,
+    vector<unsigned int>* splitSources = NULL);
@@ -0,0 +1,167 @@
+#include "programCache.h"
+
+#include "glad/glad.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <sys/stat.h>
+
+static uint64_t hashBytes(const unsigned char* bytes, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static uint64_t hashString(const string& s, uint64_t hash) {
+    //the length separates the strings, "ab" + "c" and "a" + "bc" do not collide
+    uint64_t length = s.size();
+    hash = hashBytes((const unsigned char*)&length, sizeof(length), hash);
+    return hashBytes((const unsigned char*)s.data(), s.size(), hash);
+}
+
+static string getGlString(unsigned int name) {
+    const char* value = (const char*)glGetString(name);
+    return value == NULL ? "" : value;
+}
+
+programCache* programCache::get() {
+    static programCache cache;
+    return &cache;
+}
+
+programCache::programCache() :
+    enabled(true),
+    hits(0),
+    misses(0),
+    rejected(0),
+    loadSeconds(0.),
+    compileSecondsSaved(0.),
+    supported(-1) {
+}
+
+bool programCache::isSupported() {
+    if (this->supported == -1) {
+        int formatCount = 0;
+        if (glGetProgramBinary != NULL && glProgramBinary != NULL) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        }
+        this->supported = formatCount > 0;
+    }
+    return this->supported == 1;
+}
+
+uint64_t programCache::getKey(const string& vertexSource, const string& geometrySource, const string& fragmentSource) {
+    uint64_t key = hashBytes(NULL, 0);
+    key = hashString(getGlString(GL_VENDOR), key);
+    key = hashString(getGlString(GL_RENDERER), key);
+    key = hashString(getGlString(GL_VERSION), key);
+    key = hashString(vertexSource, key);
+    key = hashString(geometrySource, key);
+    return hashString(fragmentSource, key);
+}
+
+string programCache::getFileName(uint64_t key) {
+    char name[64];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return PROGRAM_CACHE_DIRECTORY + string(name);
+}
+
+unsigned int programCache::load(uint64_t key) {
+    if (!this->enabled || !this->isSupported()) {
+        return 0;
+    }
+    auto start = chrono::steady_clock::now();
+    string fileName = this->getFileName(key);
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if (!file) {
+        this->misses++;
+        return 0;
+    }
+    programCacheHeader header;
+    vector<char> binary;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1
+        && memcmp(header.magic, "PROG", 4) == 0
+        && header.version == PROGRAM_CACHE_VERSION
+        && header.key == key;
+    if (valid) {
+        binary.resize(header.binarySize);
+        valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+    if (!valid) {
+        this->misses++;
+        return 0;
+    }
+
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary.data(), binary.size());
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        //the driver changed in a way its version string does not show, the program is compiled again and replaces the file
+        glDeleteProgram(program);
+        remove(fileName.c_str());
+        this->rejected++;
+        this->misses++;
+        return 0;
+    }
+    this->hits++;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    this->loadSeconds += seconds;
+    this->compileSecondsSaved += header.compileSeconds;
+    return program;
+}
+
+void programCache::prepareForStore(unsigned int program) {
+    if (this->enabled && this->isSupported()) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+bool programCache::store(uint64_t key, unsigned int program, double compileSeconds) {
+    if (!this->enabled || !this->isSupported()) {
+        return false;
+    }
+    int binarySize = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+    if (binarySize <= 0) {
+        return false;
+    }
+    vector<char> binary(binarySize);
+    programCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "PROG", 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    int length = 0;
+    unsigned int binaryFormat = 0;
+    glGetProgramBinary(program, binarySize, &length, &binaryFormat, binary.data());
+    if (length <= 0) {
+        return false;
+    }
+    header.binaryFormat = binaryFormat;
+    header.binarySize = length;
+    header.compileSeconds = compileSeconds;
+
+    //written next to the final file then renamed, a crash never leaves a truncated binary behind
+    mkdir(PROGRAM_CACHE_DIRECTORY, 0755);
+    string fileName = this->getFileName(key);
+    string temporaryFileName = fileName + ".tmp";
+    FILE* file = fopen(temporaryFileName.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(binary.data(), 1, length, file) == (size_t)length;
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporaryFileName.c_str(), fileName.c_str()) != 0) {
+        remove(temporaryFileName.c_str());
+        return false;
+    }
+    return true;
+}
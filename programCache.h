@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+using namespace std;
+
+#define PROGRAM_CACHE_VERSION 1
+#define PROGRAM_CACHE_DIRECTORY "./shaderCache"
+
+//shaderCache/<key>.bin : this header followed by the bytes returned by glGetProgramBinary
+struct programCacheHeader {
+    char magic[4];              // "PROG"
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+    double compileSeconds;      // time the program took to compile and link from source
+}typedef programCacheHeader;
+
+//linked programs saved on disk, keyed by their sources (defines included) and the driver that built them
+class programCache {
+public:
+    bool enabled;
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int rejected;      // binaries the driver refused, after an update for example
+    double loadSeconds;         // spent loading the hits
+    double compileSecondsSaved; // that the hits took to compile when they were missed
+
+    static programCache* get();
+
+    programCache();
+    //false when the driver has no binary format to offer
+    bool isSupported();
+    uint64_t getKey(const string& vertexSource, const string& geometrySource, const string& fragmentSource);
+    //a linked program created from the cached binary, 0 when it is missing or rejected
+    unsigned int load(uint64_t key);
+    //to be called before glLinkProgram, or the driver may not keep the binary
+    void prepareForStore(unsigned int program);
+    bool store(uint64_t key, unsigned int program, double compileSeconds);
+
+private:
+    int supported;              // -1 until asked to the driver
+    string getFileName(uint64_t key);
+};
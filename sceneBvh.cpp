@@ -0,0 +1,235 @@
+#include "sceneBvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+sceneBvh::sceneBvh() :
+    refittedNodeCount(0) {
+}
+
+void sceneBvh::build(const vector<glm::vec3>& itemsMin, const vector<glm::vec3>& itemsMax) {
+    this->itemsMin = itemsMin;
+    this->itemsMax = itemsMax;
+    unsigned int itemCount = itemsMin.size();
+    this->itemOrder.resize(itemCount);
+    for (unsigned int i = 0; i < itemCount; i++) {
+        this->itemOrder[i] = i;
+    }
+    this->itemLeaves.assign(itemCount, -1);
+    //doubled centroids, only needed while splitting
+    this->centroids.resize(itemCount);
+    for (unsigned int i = 0; i < itemCount; i++) {
+        this->centroids[i] = itemsMin[i] + itemsMax[i];
+    }
+    this->itemMoved.assign(itemCount, false);
+    this->movedItems.clear();
+    this->nodes.clear();
+    this->nodes.reserve(2 * (itemCount / BVH_LEAF_SIZE + 1));
+    if (itemCount > 0) {
+        this->nodes.push_back(bvhNode());
+        this->buildNode(0, -1, 0, itemCount);
+    }
+    this->refittedNodeCount = this->nodes.size();
+    vector<glm::vec3>().swap(this->centroids);
+}
+
+//node is already allocated, its children are allocated by pairs after it (children always have a bigger index than their parent)
+void sceneBvh::buildNode(int node, int parent, unsigned int firstItem, unsigned int itemCount) {
+    glm::vec3 boundsMin = glm::vec3(FLT_MAX), boundsMax = glm::vec3(-FLT_MAX);
+    glm::vec3 centroidMin = glm::vec3(FLT_MAX), centroidMax = glm::vec3(-FLT_MAX);
+    for (unsigned int i = firstItem; i < firstItem + itemCount; i++) {
+        unsigned int item = this->itemOrder[i];
+        boundsMin = glm::min(boundsMin, this->itemsMin[item]);
+        boundsMax = glm::max(boundsMax, this->itemsMax[item]);
+        centroidMin = glm::min(centroidMin, this->centroids[item]);
+        centroidMax = glm::max(centroidMax, this->centroids[item]);
+    }
+    this->nodes[node].boundsMin = boundsMin;
+    this->nodes[node].boundsMax = boundsMax;
+    this->nodes[node].parent = parent;
+    this->nodes[node].firstItem = firstItem;
+    this->nodes[node].itemCount = itemCount;
+    this->nodes[node].leftChild = -1;
+    if (itemCount <= BVH_LEAF_SIZE) {
+        for (unsigned int i = firstItem; i < firstItem + itemCount; i++) {
+            this->itemLeaves[this->itemOrder[i]] = node;
+        }
+        return;
+    }
+
+    //median split along the longest axis of the centroids
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    unsigned int half = itemCount / 2;
+    const glm::vec3* centroids = this->centroids.data();
+    nth_element(this->itemOrder.begin() + firstItem, this->itemOrder.begin() + firstItem + half, this->itemOrder.begin() + firstItem + itemCount,
+        [&](unsigned int a, unsigned int b) { return centroids[a][axis] < centroids[b][axis]; });
+
+    int leftChild = this->nodes.size();
+    this->nodes[node].leftChild = leftChild;
+    this->nodes.push_back(bvhNode());
+    this->nodes.push_back(bvhNode());
+    this->buildNode(leftChild, node, firstItem, half);
+    this->buildNode(leftChild + 1, node, firstItem + half, itemCount - half);
+}
+
+unsigned int sceneBvh::getItemCount() {
+    return this->itemsMin.size();
+}
+
+void sceneBvh::setItemBounds(unsigned int item, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    if (this->itemsMin[item] == boundsMin && this->itemsMax[item] == boundsMax) {
+        return;
+    }
+    this->itemsMin[item] = boundsMin;
+    this->itemsMax[item] = boundsMax;
+    if (!this->itemMoved[item]) {
+        this->itemMoved[item] = true;
+        this->movedItems.push_back(item);
+    }
+}
+
+bool sceneBvh::updateNodeBounds(int node) {
+    bvhNode* n = &this->nodes[node];
+    glm::vec3 boundsMin, boundsMax;
+    if (n->leftChild == -1) {
+        boundsMin = glm::vec3(FLT_MAX);
+        boundsMax = glm::vec3(-FLT_MAX);
+        for (unsigned int i = n->firstItem; i < n->firstItem + n->itemCount; i++) {
+            boundsMin = glm::min(boundsMin, this->itemsMin[this->itemOrder[i]]);
+            boundsMax = glm::max(boundsMax, this->itemsMax[this->itemOrder[i]]);
+        }
+    }
+    else {
+        bvhNode* left = &this->nodes[n->leftChild];
+        bvhNode* right = left + 1;
+        boundsMin = glm::min(left->boundsMin, right->boundsMin);
+        boundsMax = glm::max(left->boundsMax, right->boundsMax);
+    }
+    this->refittedNodeCount++;
+    if (boundsMin == n->boundsMin && boundsMax == n->boundsMax) {
+        return false;
+    }
+    n->boundsMin = boundsMin;
+    n->boundsMax = boundsMax;
+    return true;
+}
+
+void sceneBvh::refit() {
+    this->refittedNodeCount = 0;
+    if (this->movedItems.empty()) {
+        return;
+    }
+    //past this many moved items, the paths to the root overlap so much that a single bottom up pass is cheaper
+    if (this->movedItems.size() > this->getItemCount() / 16) {
+        for (int node = this->nodes.size() - 1; node >= 0; node--) {
+            this->updateNodeBounds(node);
+        }
+    }
+    else {
+        for (unsigned int item : this->movedItems) {
+            //stops as soon as a node keeps its bounds, its ancestors can not change either
+            int node = this->itemLeaves[item];
+            while (node != -1 && this->updateNodeBounds(node)) {
+                node = this->nodes[node].parent;
+            }
+        }
+    }
+    for (unsigned int item : this->movedItems) {
+        this->itemMoved[item] = false;
+    }
+    this->movedItems.clear();
+}
+
+void sceneBvh::cullFrustum(frustum* viewFrustum, vector<unsigned int>* visibleItems) {
+    if (this->nodes.empty()) {
+        return;
+    }
+    this->stack.clear();
+    this->stack.push_back(0);
+    while (!this->stack.empty()) {
+        bvhNode* n = &this->nodes[this->stack.back()];
+        this->stack.pop_back();
+        int result = viewFrustum->classifyBox(0.5f * (n->boundsMin + n->boundsMax), 0.5f * (n->boundsMax - n->boundsMin));
+        if (result == FRUSTUM_OUTSIDE) {
+            continue;
+        }
+        if (result == FRUSTUM_INSIDE) {
+            visibleItems->insert(visibleItems->end(), this->itemOrder.begin() + n->firstItem, this->itemOrder.begin() + n->firstItem + n->itemCount);
+            continue;
+        }
+        if (n->leftChild == -1) {
+            for (unsigned int i = n->firstItem; i < n->firstItem + n->itemCount; i++) {
+                unsigned int item = this->itemOrder[i];
+                glm::vec3 center = 0.5f * (this->itemsMin[item] + this->itemsMax[item]);
+                if (viewFrustum->intersectsBox(center, 0.5f * (this->itemsMax[item] - this->itemsMin[item]))) {
+                    visibleItems->push_back(item);
+                }
+            }
+            continue;
+        }
+        this->stack.push_back(n->leftChild);
+        this->stack.push_back(n->leftChild + 1);
+    }
+}
+
+//slab test, distance to the entry point or -1 if the box is missed
+static float intersectRayBox(const glm::vec3& origin, const glm::vec3& inverseDirection, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float maxDistance) {
+    glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+    glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+    glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+    float entry = max(max(tNear.x, tNear.y), max(tNear.z, 0.f));
+    float exit = min(min(tFar.x, tFar.y), min(tFar.z, maxDistance));
+    return entry <= exit ? entry : -1.f;
+}
+
+int sceneBvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float* distance,
+    function<bool(unsigned int item, float maxDistance, float* distance)> hitItem) {
+    int nearestItem = -1;
+    float nearestDistance = FLT_MAX;
+    if (this->nodes.empty()) {
+        return -1;
+    }
+    glm::vec3 inverseDirection = 1.f / direction;
+    this->stack.clear();
+    if (intersectRayBox(origin, inverseDirection, this->nodes[0].boundsMin, this->nodes[0].boundsMax, nearestDistance) >= 0.f) {
+        this->stack.push_back(0);
+    }
+    while (!this->stack.empty()) {
+        bvhNode* n = &this->nodes[this->stack.back()];
+        this->stack.pop_back();
+        if (n->leftChild == -1) {
+            for (unsigned int i = n->firstItem; i < n->firstItem + n->itemCount; i++) {
+                unsigned int item = this->itemOrder[i];
+                float hit = intersectRayBox(origin, inverseDirection, this->itemsMin[item], this->itemsMax[item], nearestDistance);
+                if (hit >= 0.f && hitItem && !hitItem(item, nearestDistance, &hit)) {
+                    continue;
+                }
+                if (hit >= 0.f && hit < nearestDistance) {
+                    nearestDistance = hit;
+                    nearestItem = item;
+                }
+            }
+            continue;
+        }
+        //the nearest child is pushed last so that it is visited first, it often shrinks nearestDistance enough to skip the other
+        int left = n->leftChild, right = n->leftChild + 1;
+        float leftHit = intersectRayBox(origin, inverseDirection, this->nodes[left].boundsMin, this->nodes[left].boundsMax, nearestDistance);
+        float rightHit = intersectRayBox(origin, inverseDirection, this->nodes[right].boundsMin, this->nodes[right].boundsMax, nearestDistance);
+        if (leftHit >= 0.f && rightHit >= 0.f) {
+            this->stack.push_back(leftHit < rightHit ? right : left);
+            this->stack.push_back(leftHit < rightHit ? left : right);
+        }
+        else if (leftHit >= 0.f) {
+            this->stack.push_back(left);
+        }
+        else if (rightHit >= 0.f) {
+            this->stack.push_back(right);
+        }
+    }
+    if (nearestItem != -1 && distance) {
+        *distance = nearestDistance;
+    }
+    return nearestItem;
+}
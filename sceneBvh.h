@@ -0,0 +1,53 @@
+#pragma once
+
+#include "frustum.h"
+
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+
+using namespace std;
+
+#define BVH_LEAF_SIZE 4
+
+struct bvhNode {
+    glm::vec3 boundsMin;
+    int leftChild;              // the right child is leftChild + 1, -1 for a leaf
+    glm::vec3 boundsMax;
+    int parent;                 // -1 for the root
+    unsigned int firstItem;     // items of the subtree are itemOrder[firstItem, firstItem + itemCount)
+    unsigned int itemCount;
+}typedef bvhNode;
+
+//bounding volume hierarchy over the world space AABBs of the scene items
+//built with median splits, then refitted in place when only a few items move
+class sceneBvh {
+public:
+    vector<bvhNode> nodes;
+    vector<unsigned int> itemOrder;
+    unsigned int refittedNodeCount;     // nodes whose bounds were recomputed by the last refit
+    sceneBvh();
+    void build(const vector<glm::vec3>& itemsMin, const vector<glm::vec3>& itemsMax);
+    unsigned int getItemCount();
+    //stores the new bounds of an item, the tree is updated by the next refit
+    void setItemBounds(unsigned int item, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+    //walks up from the leaves of the moved items only, or refits the whole tree when many of them moved
+    void refit();
+    //appends the items whose AABB intersects the frustum, subtrees fully inside are taken without testing their items
+    void cullFrustum(frustum* viewFrustum, vector<unsigned int>* visibleItems);
+    //nearest item whose AABB is hit by the ray, -1 if none (distance is in units of direction)
+    //when given, hitItem refines the test of the items whose AABB is hit closer than maxDistance : it returns false on a miss, or the exact distance
+    int raycast(const glm::vec3& origin, const glm::vec3& direction, float* distance,
+        function<bool(unsigned int item, float maxDistance, float* distance)> hitItem = NULL);
+private:
+    vector<glm::vec3> itemsMin;
+    vector<glm::vec3> itemsMax;
+    vector<int> itemLeaves;
+    vector<unsigned int> movedItems;
+    vector<bool> itemMoved;
+    vector<unsigned int> stack;
+    vector<glm::vec3> centroids;
+    void buildNode(int node, int parent, unsigned int firstItem, unsigned int itemCount);
+    //recomputes the bounds of a node from its children or items, returns false if they did not change
+    bool updateNodeBounds(int node);
+};
@@ -0,0 +1,414 @@
+#include "shader.h"
+#include "uniformBuffer.h"
+#include "programCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+
+#include <GLFW/glfw3.h>
+#include <glm/gtc/type_ptr.hpp>
+
+string readFile(const char* filename) {
+
+    // 1. retrieve the shader source code from filePath
+    std::string shaderCode;
+    std::string fragmentCode;
+    std::ifstream shaderFile;
+    // ensure ifstream objects can throw exceptions:
+    shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    try {
+        // open files
+        shaderFile.open(filename);
+        std::stringstream shaderStream;
+        // read file's buffer contents into streams
+        shaderStream << shaderFile.rdbuf();
+        // close file handlers
+        shaderFile.close();
+        // convert stream into string
+        shaderCode = shaderStream.str();
+    }
+    catch (std::ifstream::failure e) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+    }
+    return shaderCode;
+}
+
+string readShaderSource(const char* fileName, const string& defines) {
+    string source = readFile(fileName);
+    if (defines.empty()) return source;
+    //#version has to stay the first line, #line keeps the error messages on the lines of the file
+    size_t version = source.find("#version");
+    size_t insertAt = version == string::npos ? 0 : source.find('\n', version);
+    if (insertAt == string::npos) {
+        source += '\n';
+        insertAt = source.size();
+    }
+    else if (version != string::npos) {
+        insertAt++;
+    }
+    int nextLine = 1 + count(source.begin(), source.begin() + insertAt, '\n');
+    return source.insert(insertAt, defines + "#line " + to_string(nextLine) + "\n");
+}
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+bool supportsParallelShaderCompile() {
+    static int supported = -1;
+    if (supported == -1) {
+        supported = 0;
+        const char* maxThreadsFunctionName = NULL;
+        int extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (int i = 0; i < extensionCount && !supported; i++) {
+            const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (extension == NULL) continue;
+            if (strcmp(extension, "GL_KHR_parallel_shader_compile") == 0) {
+                supported = 1;
+                maxThreadsFunctionName = "glMaxShaderCompilerThreadsKHR";
+            }
+            else if (strcmp(extension, "GL_ARB_parallel_shader_compile") == 0) {
+                supported = 1;
+                maxThreadsFunctionName = "glMaxShaderCompilerThreadsARB";
+            }
+        }
+        //glad only loads the core functions, the entry point of the extension is fetched by hand
+        //0xFFFFFFFF lets the driver use as many compiler threads as it wants, some only compile in the background once it is set
+        if (supported) {
+            PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress(maxThreadsFunctionName);
+            if (maxShaderCompilerThreads != NULL) {
+                maxShaderCompilerThreads(0xFFFFFFFF);
+            }
+        }
+    }
+    return supported == 1;
+}
+
+//issues the compilation only, the status is read by checkShaderCompilation
+static unsigned int submitShaderSource(const string& sourceString, unsigned int shaderType) {
+    unsigned int shader;
+    shader = glCreateShader(shaderType);
+    const char* shaderSource = sourceString.c_str();
+    glShaderSource(shader, 1, &shaderSource, NULL);
+    glCompileShader(shader);
+    return shader;
+}
+
+//appends the error to errorLog when given
+static bool checkShaderCompilation(unsigned int shader, const string& fileName, const string& defines, string* errorLog = NULL) {
+    int  success;
+    char infoLog[512];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        cout << "ERROR::SHADER::COMPILATION_FAILED\n" << fileName << (defines.empty() ? "" : " with\n" + defines) << " : " << infoLog << endl;
+        if (errorLog != NULL) {
+            *errorLog += fileName + (defines.empty() ? "" : " with\n" + defines) + " : " + infoLog + "\n";
+        }
+    }
+    return success != 0;
+}
+
+unsigned int compileShader(const char* fileName, unsigned int shaderType, const string& defines) {
+    if (fileName == NULL) return glCreateShader(shaderType);
+    unsigned int shader = submitShaderSource(readShaderSource(fileName, defines), shaderType);
+    checkShaderCompilation(shader, fileName, defines);
+    return shader;
+}
+
+void submitShaderProgram(const char* vertexShaderFileName, const char* fragmentShaderFileName, const char* geometryShaderFileName, const string& defines,
+    pendingProgram* pending) {
+    //detected before the first compilation so that the driver already has its compiler threads
+    supportsParallelShaderCompile();
+    pending->start = chrono::steady_clock::now();
+    pending->vertexShaderFileName = vertexShaderFileName;
+    pending->geometryShaderFileName = geometryShaderFileName == NULL ? "" : geometryShaderFileName;
+    pending->fragmentShaderFileName = fragmentShaderFileName;
+    pending->defines = defines;
+    pending->vertexShader = pending->geometryShader = pending->fragmentShader = 0;
+    pending->linked = false;
+    pending->errorLog.clear();
+    string vertexSource = readShaderSource(vertexShaderFileName, defines);
+    string geometrySource = geometryShaderFileName == NULL ? "" : readShaderSource(geometryShaderFileName, defines);
+    string fragmentSource = readShaderSource(fragmentShaderFileName, defines);
+    programCache* cache = programCache::get();
+    pending->cacheKey = cache->getKey(vertexSource, geometrySource, fragmentSource);
+    pending->program = cache->load(pending->cacheKey);
+    pending->loadedFromCache = pending->program != 0;
+    if (pending->loadedFromCache) {
+        pending->linked = true;
+        return;
+    }
+
+    pending->vertexShader = submitShaderSource(vertexSource, GL_VERTEX_SHADER);
+    if (geometryShaderFileName != NULL)
+        pending->geometryShader = submitShaderSource(geometrySource, GL_GEOMETRY_SHADER);
+    pending->fragmentShader = submitShaderSource(fragmentSource, GL_FRAGMENT_SHADER);
+
+    pending->program = glCreateProgram();
+    glAttachShader(pending->program, pending->vertexShader);
+    if (geometryShaderFileName != NULL)
+        glAttachShader(pending->program, pending->geometryShader);
+    glAttachShader(pending->program, pending->fragmentShader);
+    cache->prepareForStore(pending->program);
+    glLinkProgram(pending->program);
+}
+
+bool isShaderProgramComplete(const pendingProgram* pending) {
+    if (pending->loadedFromCache || !supportsParallelShaderCompile()) {
+        return true;
+    }
+    int complete = 0;
+    glGetProgramiv(pending->program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete != 0;
+}
+
+unsigned int finishShaderProgram(pendingProgram* pending) {
+    unsigned int shaderProgram = pending->program;
+    if (!pending->loadedFromCache) {
+        checkShaderCompilation(pending->vertexShader, pending->vertexShaderFileName, pending->defines, &pending->errorLog);
+        if (pending->geometryShader != 0)
+            checkShaderCompilation(pending->geometryShader, pending->geometryShaderFileName, pending->defines, &pending->errorLog);
+        checkShaderCompilation(pending->fragmentShader, pending->fragmentShaderFileName, pending->defines, &pending->errorLog);
+
+        //check for errors
+        int  success;
+        char infoLog[512];
+        glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+            cout << "ERROR LINKING SHADER PROGRAM : " << infoLog << endl;
+            pending->errorLog += string("link : ") + infoLog + "\n";
+        }
+        else {
+            pending->linked = true;
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - pending->start).count();
+            programCache::get()->store(pending->cacheKey, shaderProgram, seconds);
+        }
+
+        glDeleteShader(pending->vertexShader);
+        glDeleteShader(pending->geometryShader);
+        glDeleteShader(pending->fragmentShader);
+        pending->vertexShader = pending->geometryShader = pending->fragmentShader = 0;
+    }
+    //every program reads the per frame values from the same uniform buffer (not part of the cached binary)
+    unsigned int frameBlockIndex = glGetUniformBlockIndex(shaderProgram, FRAME_UNIFORM_BLOCK_NAME);
+    if (frameBlockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shaderProgram, frameBlockIndex, FRAME_UNIFORM_BINDING);
+    }
+    return shaderProgram;
+}
+
+unsigned int buildShaderProgram(const char* vertexShaderFileName, const char* fragmentShaderFileName, const char* geometryShaderFileName, const string& defines) {
+    pendingProgram pending;
+    submitShaderProgram(vertexShaderFileName, fragmentShaderFileName, geometryShaderFileName, defines, &pending);
+    return finishShaderProgram(&pending);
+}
+
+void shader::build(const char* vertexShaderFileName, const char* fragmentShaderFileName, const char* geometryShaderFileName, const string& defines) {
+    this->setProgram(buildShaderProgram(vertexShaderFileName, fragmentShaderFileName, geometryShaderFileName, defines));
+}
+
+void shader::setProgram(unsigned int program) {
+    this->program = program;
+    this->resolveUniforms();
+}
+
+void shader::use() {
+    glUseProgram(this->program);
+}
+
+void shader::destroy() {
+    glDeleteProgram(this->program);
+    this->program = 0;
+    this->uniformLocations.clear();
+}
+
+//one query per active uniform after linking, nothing is looked up by name while rendering
+void shader::resolveUniforms() {
+    this->uniformLocations.clear();
+    int uniformCount = 0;
+    glGetProgramiv(this->program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    char name[256];
+    for (int i = 0; i < uniformCount; i++) {
+        int size;
+        unsigned int type;
+        glGetActiveUniform(this->program, i, sizeof(name), NULL, &size, &type, name);
+        //arrays are reported as "name[0]"
+        string uniformName = name;
+        size_t bracket = uniformName.find('[');
+        if (bracket != string::npos) uniformName.resize(bracket);
+        this->uniformLocations[uniformName] = glGetUniformLocation(this->program, name);
+    }
+}
+
+void shaderPermutations::init(const char* vertexShaderFileName, const char* fragmentShaderFileName, const char* geometryShaderFileName,
+    const vector<string>& flagNames, unsigned int geometryFlags) {
+    this->vertexShaderFileName = vertexShaderFileName;
+    this->fragmentShaderFileName = fragmentShaderFileName;
+    this->geometryShaderFileName = geometryShaderFileName == NULL ? "" : geometryShaderFileName;
+    this->flagNames = flagNames;
+    this->geometryFlags = geometryFlags;
+}
+
+string shaderPermutations::getDefines(unsigned int flags) {
+    string defines;
+    for (size_t i = 0; i < this->flagNames.size(); i++) {
+        if (flags & (1u << i)) {
+            defines += "#define " + this->flagNames[i] + "\n";
+        }
+    }
+    return defines;
+}
+
+void shaderPermutations::request(unsigned int flags) {
+    if (this->programs.count(flags) || this->pending.count(flags) || this->failed.count(flags)) {
+        return;
+    }
+    bool withGeometry = (flags & this->geometryFlags) != 0 && !this->geometryShaderFileName.empty();
+    submitShaderProgram(this->vertexShaderFileName.c_str(), this->fragmentShaderFileName.c_str(),
+        withGeometry ? this->geometryShaderFileName.c_str() : NULL, this->getDefines(flags), &this->pending[flags]);
+}
+
+shader* shaderPermutations::finish(unsigned int flags) {
+    auto found = this->pending.find(flags);
+    unsigned int linkedProgram = finishShaderProgram(&found->second);
+    if (!found->second.linked) {
+        //never installed, getReady keeps returning the fallback and request does not submit it again until a reload
+        glDeleteProgram(linkedProgram);
+        this->failed[flags] = found->second.errorLog;
+        this->pending.erase(found);
+        return NULL;
+    }
+    shader* program = &this->programs[flags];
+    program->setProgram(linkedProgram);
+    this->pending.erase(found);
+    return program;
+}
+
+shader* shaderPermutations::get(unsigned int flags) {
+    auto found = this->programs.find(flags);
+    if (found != this->programs.end()) {
+        return &found->second;
+    }
+    this->request(flags);
+    shader* program = this->pending.count(flags) ? this->finish(flags) : NULL;
+    return program != NULL ? program : &this->failedProgram;
+}
+
+shader* shaderPermutations::getReady(unsigned int flags, unsigned int fallbackFlags) {
+    auto found = this->programs.find(flags);
+    if (found != this->programs.end()) {
+        return &found->second;
+    }
+    this->request(flags);
+    return this->get(fallbackFlags);
+}
+
+void shaderPermutations::poll(unsigned int maxFinished) {
+    vector<unsigned int> complete;
+    for (auto& p : this->pending) {
+        if (complete.size() < maxFinished && isShaderProgramComplete(&p.second)) {
+            complete.push_back(p.first);
+        }
+    }
+    for (unsigned int flags : complete) {
+        this->finish(flags);
+    }
+}
+
+bool shaderPermutations::usesFile(const string& fileName) {
+    return fileName == this->vertexShaderFileName || fileName == this->fragmentShaderFileName || fileName == this->geometryShaderFileName;
+}
+
+bool shaderPermutations::reload(string* errorLog) {
+    //every ready permutation is rebuilt before any is replaced, so a failure leaves the whole set as it was
+    vector<pair<unsigned int, pendingProgram>> rebuilt;
+    bool failed = false;
+    for (auto& p : this->programs) {
+        rebuilt.push_back(make_pair(p.first, pendingProgram()));
+        bool withGeometry = (p.first & this->geometryFlags) != 0 && !this->geometryShaderFileName.empty();
+        submitShaderProgram(this->vertexShaderFileName.c_str(), this->fragmentShaderFileName.c_str(),
+            withGeometry ? this->geometryShaderFileName.c_str() : NULL, this->getDefines(p.first), &rebuilt.back().second);
+    }
+    for (auto& r : rebuilt) {
+        finishShaderProgram(&r.second);
+        if (!r.second.linked) {
+            failed = true;
+            *errorLog += r.second.errorLog;
+        }
+    }
+    if (failed) {
+        for (auto& r : rebuilt) {
+            glDeleteProgram(r.second.program);
+        }
+        return false;
+    }
+    for (auto& r : rebuilt) {
+        shader* program = &this->programs[r.first];
+        program->destroy();
+        program->setProgram(r.second.program);
+    }
+    //the permutations still compiling were submitted from the old sources, the failed ones get another chance with the new ones
+    vector<unsigned int> pendingFlags;
+    for (auto& p : this->pending) {
+        pendingFlags.push_back(p.first);
+    }
+    for (auto& f : this->failed) {
+        pendingFlags.push_back(f.first);
+    }
+    this->dropPending();
+    this->failed.clear();
+    for (unsigned int flags : pendingFlags) {
+        this->request(flags);
+    }
+    return true;
+}
+
+void shaderPermutations::dropPending() {
+    //still compiling, dropped without waiting for the driver
+    for (auto& p : this->pending) {
+        glDeleteShader(p.second.vertexShader);
+        glDeleteShader(p.second.geometryShader);
+        glDeleteShader(p.second.fragmentShader);
+        glDeleteProgram(p.second.program);
+    }
+    this->pending.clear();
+}
+
+void shaderPermutations::destroy() {
+    for (auto& program : this->programs) {
+        program.second.destroy();
+    }
+    this->programs.clear();
+    this->dropPending();
+    this->failed.clear();
+}
+
+template<> void uniform<int>::set(const int& value) {
+    glUniform1i(this->location, value);
+}
+template<> void uniform<bool>::set(const bool& value) {
+    glUniform1i(this->location, value);
+}
+template<> void uniform<float>::set(const float& value) {
+    glUniform1f(this->location, value);
+}
+template<> void uniform<glm::vec3>::set(const glm::vec3& value) {
+    glUniform3fv(this->location, 1, glm::value_ptr(value));
+}
+template<> void uniform<glm::vec4>::set(const glm::vec4& value) {
+    glUniform4fv(this->location, 1, glm::value_ptr(value));
+}
+template<> void uniform<glm::mat3>::set(const glm::mat3& value) {
+    glUniformMatrix3fv(this->location, 1, GL_FALSE, glm::value_ptr(value));
+}
+template<> void uniform<glm::mat4>::set(const glm::mat4& value) {
+    glUniformMatrix4fv(this->location, 1, GL_FALSE, glm::value_ptr(value));
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+
+using namespace std;
+
+string readFile(const char* filename);
+//source of a shader file with the defines ("#define NAME" lines) inserted right after its #version line
+string readShaderSource(const char* fileName, const string& defines);
+unsigned int compileShader(const char* fileName, unsigned int shaderType, const string& defines = "");
+unsigned int buildShaderProgram(const char* vertexShaderFileName, const char* fragmentShaderFileName, const char* geometryShaderFileName = NULL, const string& defines = "");
+
+//a program whose compilation and link were issued but whose status was not read yet
+struct pendingProgram {
+    unsigned int program;
+    unsigned int vertexShader;
+    unsigned int geometryShader;
+    unsigned int fragmentShader;
+    string vertexShaderFileName;
+    string geometryShaderFileName;
+    string fragmentShaderFileName;
+    string defines;
+    uint64_t cacheKey;
+    bool loadedFromCache;
+    bool linked;                // set by finishShaderProgram
+    string errorLog;            // compile and link errors, set by finishShaderProgram
+    chrono::steady_clock::time_point start;
+}typedef pendingProgram;
+
+//GL_KHR_parallel_shader_compile : the driver compiles in the background and reports GL_COMPLETION_STATUS_KHR
+bool supportsParallelShaderCompile();
+//buildShaderProgram in two halves : submit issues the compilation and the link (or loads the cached binary) without waiting for them,
+//finish reads their status, which blocks until the driver is done unless isShaderProgramComplete returned true
+void submitShaderProgram(const char* vertexShaderFileName, const char* fragmentShaderFileName, const char* geometryShaderFileName, const string& defines,
+    pendingProgram* pending);
+//always true without GL_KHR_parallel_shader_compile
+bool isShaderProgramComplete(const pendingProgram* pending);
+unsigned int finishShaderProgram(pendingProgram* pending);
+
+//location of a uniform resolved once, set() must be called while its program is in use
+template<class T>
+struct uniform {
+    int location;
+    uniform() : location(-1) {}
+    void set(const T& value);
+};
+
+template<> void uniform<int>::set(const int& value);
+template<> void uniform<bool>::set(const bool& value);
+template<> void uniform<float>::set(const float& value);
+template<> void uniform<glm::vec3>::set(const glm::vec3& value);
+template<> void uniform<glm::vec4>::set(const glm::vec4& value);
+template<> void uniform<glm::mat3>::set(const glm::mat3& value);
+template<> void uniform<glm::mat4>::set(const glm::mat4& value);
+
+//a linked program and the locations of all its active uniforms
+class shader {
+public:
+    unsigned int program;
+
+    shader() : program(0) {}
+    void build(const char* vertexShaderFileName, const char* fragmentShaderFileName, const char* geometryShaderFileName = NULL, const string& defines = "");
+    //takes a linked program and resolves its uniforms
+    void setProgram(unsigned int program);
+    void use();
+    void destroy();
+    //uniforms that are not active in the program get a -1 location, glUniform* ignores them
+    template<class T>
+    uniform<T> getUniform(const char* name) {
+        uniform<T> u;
+        auto found = this->uniformLocations.find(name);
+        if (found != this->uniformLocations.end()) {
+            u.location = found->second;
+        }
+        return u;
+    }
+
+private:
+    unordered_map<string, int> uniformLocations;
+    void resolveUniforms();
+};
+
+//the programs specialized from the same files for each combination of feature flags,
+//bit i of the flags defines flagNames[i] in every stage. Permutations are submitted in the background by request()
+//and become ready through poll(), get() is the blocking path
+class shaderPermutations {
+public:
+    shaderPermutations() : geometryFlags(0) {}
+    //the geometry shader is only attached to the permutations having one of geometryFlags
+    void init(const char* vertexShaderFileName, const char* fragmentShaderFileName, const char* geometryShaderFileName,
+        const vector<string>& flagNames, unsigned int geometryFlags = 0);
+    void request(unsigned int flags);
+    //compiles the permutation now if it is not ready, a permutation that failed to link gives a shader without program
+    shader* get(unsigned int flags);
+    //the permutation if it is ready, otherwise it is requested and the fallback permutation is returned
+    shader* getReady(unsigned int flags, unsigned int fallbackFlags);
+    //finishes up to maxFinished pending permutations whose compilation is complete
+    void poll(unsigned int maxFinished = 1);
+    string getDefines(unsigned int flags);
+    bool usesFile(const string& fileName);
+    //rebuilds every ready permutation from the files, and swaps them all in only if they all link
+    //otherwise the old programs are kept and the errors are appended to errorLog
+    bool reload(string* errorLog);
+    int getProgramCount() {
+        return this->programs.size();
+    }
+    int getPendingCount() {
+        return this->pending.size();
+    }
+    int getFailedCount() {
+        return this->failed.size();
+    }
+    void destroy();
+
+private:
+    string vertexShaderFileName;
+    string fragmentShaderFileName;
+    string geometryShaderFileName;
+    vector<string> flagNames;
+    unsigned int geometryFlags;
+    unordered_map<unsigned int, shader> programs;
+    unordered_map<unsigned int, pendingProgram> pending;
+    unordered_map<unsigned int, string> failed;     // error log of the permutations that did not link, by flags
+    shader failedProgram;                           // program 0, draws nothing
+    //installs the program if it linked, NULL otherwise
+    shader* finish(unsigned int flags);
+    void dropPending();
+};
@@ -1,2 +1,68 @@
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+//every allocation of stb_image (the decoded pixels and the buffers used while decoding) comes from blocks reused between images,
+//the texture loader decodes on several threads and frees the pixels on the GL thread so the pool is shared
+#define POOL_CLASS_COUNT 48         // power of two sizes, from 16 bytes
+#define POOL_BLOCKS_PER_CLASS 8     // free blocks kept per size, the others go back to the system
+#define POOL_HEADER_SIZE 16         // in front of each block, keeps the 16 bytes alignment of malloc
+
+static std::mutex decodePoolMutex;
+static std::vector<void*> decodePoolBlocks[POOL_CLASS_COUNT];
+
+static unsigned int getPoolClass(size_t size) {
+    unsigned int sizeClass = 0;
+    while (sizeClass + 1 < POOL_CLASS_COUNT && ((size_t)16 << sizeClass) < size) sizeClass++;
+    return sizeClass;
+}
+
+static void* poolMalloc(size_t size) {
+    unsigned int sizeClass = getPoolClass(size);
+    char* block = NULL;
+    {
+        std::lock_guard<std::mutex> lock(decodePoolMutex);
+        if (!decodePoolBlocks[sizeClass].empty()) {
+            block = (char*)decodePoolBlocks[sizeClass].back();
+            decodePoolBlocks[sizeClass].pop_back();
+        }
+    }
+    if (!block) {
+        block = (char*)malloc(POOL_HEADER_SIZE + ((size_t)16 << sizeClass));
+        if (!block) return NULL;
+        *(unsigned int*)block = sizeClass;
+    }
+    return block + POOL_HEADER_SIZE;
+}
+
+static void poolFree(void* pointer) {
+    if (!pointer) return;
+    char* block = (char*)pointer - POOL_HEADER_SIZE;
+    unsigned int sizeClass = *(unsigned int*)block;
+    {
+        std::lock_guard<std::mutex> lock(decodePoolMutex);
+        if (decodePoolBlocks[sizeClass].size() < POOL_BLOCKS_PER_CLASS) {
+            decodePoolBlocks[sizeClass].push_back(block);
+            return;
+        }
+    }
+    free(block);
+}
+
+static void* poolRealloc(void* pointer, size_t oldSize, size_t newSize) {
+    if (!pointer) return poolMalloc(newSize);
+    unsigned int sizeClass = *(unsigned int*)((char*)pointer - POOL_HEADER_SIZE);
+    if (newSize <= ((size_t)16 << sizeClass)) return pointer;
+    void* grown = poolMalloc(newSize);
+    if (!grown) return NULL;
+    memcpy(grown, pointer, oldSize < newSize ? oldSize : newSize);
+    poolFree(pointer);
+    return grown;
+}
+
+#define STBI_MALLOC(size) poolMalloc(size)
+#define STBI_REALLOC_SIZED(pointer, oldSize, newSize) poolRealloc(pointer, oldSize, newSize)
+#define STBI_FREE(pointer) poolFree(pointer)
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
\ No newline at end of file
+#include "stb_image.h"
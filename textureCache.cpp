@@ -0,0 +1,134 @@
+#include "textureCache.h"
+#include "textureLoader.h"
+
+#include "glad/glad.h"
+#include "stb_image.h"
+
+textureCache* textureCache::get() {
+    static textureCache cache;
+    return &cache;
+}
+
+textureCache::textureCache() :
+    dedupByContent(false),
+    hits(0),
+    misses(0),
+    bytesSaved(0) {}
+
+unsigned int textureCache::reuse(unsigned int texture) {
+    entry* e = &this->entries[texture];
+    e->refCount++;
+    this->hits++;
+    this->bytesSaved += e->byteSize;
+    return texture;
+}
+
+unsigned int textureCache::acquire(const char* fileName) {
+    auto byFileName = this->textureByFileName.find(fileName);
+    if (byFileName != this->textureByFileName.end()) {
+        return this->reuse(byFileName->second);
+    }
+
+    entry e;
+    e.fileName = fileName;
+    e.contentHash = 0;
+    e.byteSize = 0;
+    e.refCount = 1;
+    e.loadRequest = 0;
+    //only the image header is read here, the decoding (and the hashing) happens on the loader threads
+    string fullFileName = string("./textures/") + fileName;
+    int width = 0, height = 0, channelCount = 0;
+    if (stbi_info(fullFileName.c_str(), &width, &height, &channelCount)) {
+        e.byteSize = (size_t)width * height * channelCount;
+    }
+
+    this->misses++;
+    unsigned int texture = this->createTexture(fileName, &e.loadRequest);
+    this->entries[texture] = e;
+    this->textureByFileName[fileName] = texture;
+    return texture;
+}
+
+void textureCache::retain(unsigned int texture) {
+    auto found = this->entries.find(texture);
+    if (found != this->entries.end()) {
+        found->second.refCount++;
+    }
+}
+
+void textureCache::release(unsigned int texture) {
+    auto found = this->entries.find(texture);
+    if (found == this->entries.end()) {
+        return;
+    }
+    if (--found->second.refCount > 0) {
+        return;
+    }
+    //forget every file name that resolved to this texture
+    for (auto it = this->textureByFileName.begin(); it != this->textureByFileName.end();) {
+        if (it->second == texture) it = this->textureByFileName.erase(it);
+        else it++;
+    }
+    auto byContent = this->textureByContent.find(found->second.contentHash);
+    if (found->second.contentHash != 0 && byContent != this->textureByContent.end() && byContent->second == texture) {
+        this->textureByContent.erase(byContent);
+    }
+    textureLoader::get()->cancel(found->second.loadRequest);
+    this->entries.erase(found);
+    glDeleteTextures(1, &texture);
+}
+
+unsigned int textureCache::uploadPending(unsigned int maxUploads, vector<pair<unsigned int, unsigned int>>* mergedTextures) {
+    vector<textureLoader::decodedImage> images;
+    textureLoader::get()->takeDecodedImages(maxUploads, &images);
+    for (textureLoader::decodedImage& image : images) {
+        auto found = this->entries.find(image.texture);
+        if (image.contentHash == 0 || !image.pixels || found == this->entries.end()) {
+            textureLoader::upload(&image);
+            continue;
+        }
+        auto byContent = this->textureByContent.find(image.contentHash);
+        if (byContent == this->textureByContent.end() || !this->dedupByContent) {
+            found->second.contentHash = image.contentHash;
+            this->textureByContent.emplace(image.contentHash, image.texture);
+            textureLoader::upload(&image);
+            continue;
+        }
+        //same content as a texture already uploaded, its users and file names move to it
+        unsigned int kept = byContent->second;
+        entry* keptEntry = &this->entries[kept];
+        keptEntry->refCount += found->second.refCount;
+        this->bytesSaved += found->second.byteSize;
+        for (auto& byFileName : this->textureByFileName) {
+            if (byFileName.second == image.texture) byFileName.second = kept;
+        }
+        this->entries.erase(found);
+        glDeleteTextures(1, &image.texture);
+        stbi_image_free(image.pixels);
+        mergedTextures->push_back(make_pair(image.texture, kept));
+    }
+    return images.size();
+}
+
+unsigned int textureCache::getTextureCount() {
+    return this->entries.size();
+}
+
+unsigned int textureCache::createTexture(const char* fileName, unsigned int* loadRequest) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
+    // set the texture wrapping parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // set texture filtering parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);// or GL_LINEAR
+
+    //placeholder texel until the image is decoded by a worker and uploaded by textureLoader::uploadPending
+    unsigned char placeholder[3] = { 200, 200, 200 };
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, placeholder);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    *loadRequest = textureLoader::get()->request(texture, fileName, this->dedupByContent);
+    return texture;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+//reference counted GL textures, a file already loaded is never decoded nor uploaded twice
+class textureCache {
+public:
+    //also share the texture between different files with the same content, off by default
+    //the files are hashed by the loader workers, a duplicate is merged into the existing texture when its image arrives
+    bool dedupByContent;
+    unsigned int hits;
+    unsigned int misses;
+    size_t bytesSaved;  // decoded image bytes that did not have to be decoded and uploaded again
+
+    static textureCache* get();
+
+    textureCache();
+    //GL thread only, the texture is decoded asynchronously by textureLoader on a miss
+    unsigned int acquire(const char* fileName);
+    //one more user of an already acquired texture
+    void retain(unsigned int texture);
+    //deletes the texture when its last user releases it
+    void release(unsigned int texture);
+    //GL thread only, uploads the images decoded by textureLoader, returns the number of images handled
+    //appends (duplicate, kept texture) for each texture merged into an existing one with the same content, the duplicate is
+    //deleted and its users have to switch to the kept texture, which already holds their references
+    unsigned int uploadPending(unsigned int maxUploads, vector<pair<unsigned int, unsigned int>>* mergedTextures);
+    unsigned int getTextureCount();
+
+private:
+    struct entry {
+        string fileName;
+        uint64_t contentHash;
+        size_t byteSize;
+        unsigned int refCount;
+        unsigned int loadRequest;   // of textureLoader, cancelled when the texture is deleted
+    };
+    unordered_map<unsigned int, entry> entries;
+    unordered_map<string, unsigned int> textureByFileName;
+    unordered_map<uint64_t, unsigned int> textureByContent;
+
+    unsigned int reuse(unsigned int texture);
+    unsigned int createTexture(const char* fileName, unsigned int* loadRequest);
+};
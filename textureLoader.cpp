@@ -0,0 +1,188 @@
+#include "textureLoader.h"
+
+#include <iostream>
+#include <cstdio>
+
+#include "stb_image.h"
+
+static uint64_t hashBytes(const unsigned char* bytes, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+textureLoader* textureLoader::get() {
+    static textureLoader loader;
+    return &loader;
+}
+
+textureLoader::textureLoader(unsigned int threadCount) :
+    nextRequestId(1),
+    pendingCount(0),
+    stopping(false) {
+    if (threadCount == 0) {
+        //the render thread keeps a core for itself
+        unsigned int coreCount = thread::hardware_concurrency();
+        threadCount = coreCount > 1 ? coreCount - 1 : 1;
+    }
+    for (unsigned int i = 0; i < threadCount; i++) {
+        this->workers.push_back(thread(&textureLoader::workerLoop, this));
+    }
+}
+
+textureLoader::~textureLoader() {
+    {
+        lock_guard<mutex> lock(this->queueMutex);
+        this->stopping = true;
+    }
+    this->queueCondition.notify_all();
+    for (thread& worker : this->workers) {
+        worker.join();
+    }
+    for (decodedImage& image : this->decodedImages) {
+        stbi_image_free(image.pixels);
+    }
+}
+
+unsigned int textureLoader::request(unsigned int texture, const char* fileName, bool hashContent) {
+    loadRequest request;
+    request.texture = texture;
+    request.fileName = fileName;
+    request.hashContent = hashContent;
+    {
+        lock_guard<mutex> lock(this->queueMutex);
+        request.id = this->nextRequestId++;
+        if (this->nextRequestId == 0) this->nextRequestId = 1;
+        this->activeRequests.insert(request.id);
+        this->requests.push_back(request);
+        this->pendingCount++;
+    }
+    this->queueCondition.notify_one();
+    return request.id;
+}
+
+void textureLoader::cancel(unsigned int requestId) {
+    lock_guard<mutex> lock(this->queueMutex);
+    if (this->activeRequests.erase(requestId) == 0) {
+        return;
+    }
+    //not decoded yet, the workers can skip it, otherwise its image is dropped by uploadPending
+    for (auto it = this->requests.begin(); it != this->requests.end(); it++) {
+        if (it->id == requestId) {
+            this->requests.erase(it);
+            this->pendingCount--;
+            break;
+        }
+    }
+}
+
+unsigned int textureLoader::getPendingCount() {
+    lock_guard<mutex> lock(this->queueMutex);
+    return this->pendingCount;
+}
+
+vector<unsigned char> textureLoader::acquireStagingBuffer() {
+    lock_guard<mutex> lock(this->stagingMutex);
+    if (this->stagingBuffers.empty()) {
+        return vector<unsigned char>();
+    }
+    vector<unsigned char> buffer = move(this->stagingBuffers.back());
+    this->stagingBuffers.pop_back();
+    return buffer;
+}
+
+void textureLoader::releaseStagingBuffer(vector<unsigned char> buffer) {
+    lock_guard<mutex> lock(this->stagingMutex);
+    this->stagingBuffers.push_back(move(buffer));
+}
+
+void textureLoader::workerLoop() {
+    while (true) {
+        loadRequest request;
+        {
+            unique_lock<mutex> lock(this->queueMutex);
+            this->queueCondition.wait(lock, [this]() { return this->stopping || !this->requests.empty(); });
+            if (this->stopping) return;
+            request = this->requests.front();
+            this->requests.pop_front();
+        }
+        decodedImage image;
+        image.requestId = request.id;
+        image.texture = request.texture;
+        image.fileName = request.fileName;
+        image.pixels = NULL;
+        image.width = image.height = image.channelCount = 0;
+        image.contentHash = 0;
+
+        string fullFileName = "./textures/" + request.fileName;
+        FILE* file = fopen(fullFileName.c_str(), "rb");
+        if (file) {
+            vector<unsigned char> staging = this->acquireStagingBuffer();
+            fseek(file, 0, SEEK_END);
+            long size = ftell(file);
+            fseek(file, 0, SEEK_SET);
+            //the buffer only grows, a pooled buffer is usually big enough already
+            if (size > 0 && (size_t)size > staging.size()) staging.resize(size);
+            if (size > 0 && fread(staging.data(), 1, size, file) == (size_t)size) {
+                if (request.hashContent) image.contentHash = hashBytes(staging.data(), size);
+                image.pixels = stbi_load_from_memory(staging.data(), size, &image.width, &image.height, &image.channelCount, 0);
+            }
+            fclose(file);
+            this->releaseStagingBuffer(move(staging));
+        }
+
+        lock_guard<mutex> lock(this->queueMutex);
+        this->decodedImages.push_back(image);
+    }
+}
+
+void textureLoader::takeDecodedImages(unsigned int maxCount, vector<decodedImage>* images) {
+    vector<decodedImage> cancelledImages;
+    {
+        lock_guard<mutex> lock(this->queueMutex);
+        unsigned int count = min<size_t>(maxCount, this->decodedImages.size());
+        for (unsigned int i = 0; i < count; i++) {
+            decodedImage& image = this->decodedImages[i];
+            //the texture was released before its image arrived, its name may already belong to another texture
+            if (this->activeRequests.erase(image.requestId) == 0) {
+                cancelledImages.push_back(image);
+            }
+            else {
+                images->push_back(image);
+            }
+        }
+        this->decodedImages.erase(this->decodedImages.begin(), this->decodedImages.begin() + count);
+        this->pendingCount -= count;
+    }
+    for (decodedImage& image : cancelledImages) {
+        stbi_image_free(image.pixels);
+    }
+}
+
+void textureLoader::upload(decodedImage* image) {
+    if (!image->pixels) {
+        std::cout << "Failed to load texture : " << image->fileName << std::endl;
+        return;
+    }
+    unsigned int sourcePixelFormat = GL_RGB;
+    if (image->channelCount == 4) {
+        sourcePixelFormat = GL_RGBA;
+    }
+    glBindTexture(GL_TEXTURE_2D, image->texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image->width, image->height, 0, sourcePixelFormat, GL_UNSIGNED_BYTE, image->pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    stbi_image_free(image->pixels);
+    image->pixels = NULL;
+}
+
+unsigned int textureLoader::uploadPending(unsigned int maxUploads) {
+    vector<decodedImage> images;
+    this->takeDecodedImages(maxUploads, &images);
+    for (decodedImage& image : images) {
+        textureLoader::upload(&image);
+    }
+    return images.size();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <unordered_set>
+#include <string>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "glad/glad.h"
+
+using namespace std;
+
+//decodes images on worker threads, the GL thread only uploads them (a bounded number per frame)
+class textureLoader {
+public:
+    struct decodedImage {
+        unsigned int requestId;
+        unsigned int texture;
+        string fileName;
+        unsigned char* pixels;  // from the block pool of stb_image.cpp, freed with stbi_image_free, NULL if the decoding failed
+        int width;
+        int height;
+        int channelCount;
+        uint64_t contentHash;   // FNV-1a of the file, 0 if it was not asked for
+    };
+    //the shared loader used by gameItem::loadTexture
+    static textureLoader* get();
+
+    textureLoader(unsigned int threadCount = 0);
+    ~textureLoader();
+    //texture already exists (with its placeholder), its content is replaced once fileName is decoded
+    //hashContent also hashes the file on the worker, for textureCache::dedupByContent
+    //returns the id of the request, never 0
+    unsigned int request(unsigned int texture, const char* fileName, bool hashContent = false);
+    //the image of the request is never uploaded, to call before the texture is deleted since GL gives its name again
+    void cancel(unsigned int requestId);
+    //GL thread only, returns the number of textures uploaded
+    unsigned int uploadPending(unsigned int maxUploads);
+    //at most maxCount decoded images of requests still active, to give to upload or to free with stbi_image_free
+    void takeDecodedImages(unsigned int maxCount, vector<decodedImage>* images);
+    //GL thread only, replaces the content of image->texture and frees the pixels
+    static void upload(decodedImage* image);
+    unsigned int getPendingCount();
+
+private:
+    struct loadRequest {
+        unsigned int id;
+        unsigned int texture;
+        string fileName;
+        bool hashContent;
+    };
+    vector<thread> workers;
+    mutex queueMutex;
+    condition_variable queueCondition;
+    deque<loadRequest> requests;
+    vector<decodedImage> decodedImages;
+    unordered_set<unsigned int> activeRequests;     // requested and neither uploaded nor cancelled
+    unsigned int nextRequestId;
+    unsigned int pendingCount;
+    bool stopping;
+    //staging memory the files are read into before decoding, reused between requests
+    mutex stagingMutex;
+    vector<vector<unsigned char>> stagingBuffers;
+
+    void workerLoop();
+    vector<unsigned char> acquireStagingBuffer();
+    void releaseStagingBuffer(vector<unsigned char> buffer);
+};
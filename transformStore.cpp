@@ -0,0 +1,349 @@
+#include "transformStore.h"
+
+#include <cmath>
+#include <algorithm>
+
+#define LOCAL_DIRTY 1   // its own fields changed
+#define WORLD_DIRTY 2   // an ancestor changed
+
+template <typename T>
+static void permute(vector<T>* values, const vector<unsigned int>& order) {
+    vector<T> sorted(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sorted[i] = (*values)[order[i]];
+    }
+    values->swap(sorted);
+}
+
+//transpose(inverse(mat3(m))) from the cofactors of the upper 3x3, no general inverse
+static glm::mat3 computeNormalMatrix(const glm::mat4& m) {
+    glm::vec3 x = glm::vec3(m[0]), y = glm::vec3(m[1]), z = glm::vec3(m[2]);
+    glm::mat3 cofactors = glm::mat3(glm::cross(y, z), glm::cross(z, x), glm::cross(x, y));
+    float determinant = glm::dot(x, cofactors[0]);
+    //a zero scale has no inverse, the direction of the cofactors is still usable since the shader normalizes
+    return determinant != 0.f ? cofactors / determinant : cofactors;
+}
+
+transformHandle transformStore::create(const glm::vec3& position, const glm::vec3& scale, const glm::vec3& rotationAxis, float rotationAngle, transformHandle parent) {
+    transformHandle handle;
+    if (!this->freeHandles.empty()) {
+        handle = this->freeHandles.back();
+        this->freeHandles.pop_back();
+    }
+    else {
+        handle = this->indices.size();
+        this->indices.push_back(INVALID_TRANSFORM);
+    }
+    this->indices[handle] = this->handles.size();
+    this->handles.push_back(handle);
+    this->positionX.push_back(position.x);
+    this->positionY.push_back(position.y);
+    this->positionZ.push_back(position.z);
+    this->scaleX.push_back(scale.x);
+    this->scaleY.push_back(scale.y);
+    this->scaleZ.push_back(scale.z);
+    this->axisX.push_back(rotationAxis.x);
+    this->axisY.push_back(rotationAxis.y);
+    this->axisZ.push_back(rotationAxis.z);
+    this->angle.push_back(rotationAngle);
+    //appended after its parent, the order stays valid
+    this->parents.push_back(INVALID_TRANSFORM);
+    if (parent != INVALID_TRANSFORM && this->isValid(parent)) {
+        this->parents.back() = this->indices[parent];
+        this->childCount++;
+    }
+    this->localMatrices.push_back(glm::mat4(1.f));
+    this->modelMatrices.push_back(glm::mat4(1.f));
+    this->normalMatrices.push_back(glm::mat3(1.f));
+    this->dirty.push_back(0);
+    this->markDirty(handle);
+    return handle;
+}
+
+void transformStore::destroy(transformHandle handle) {
+    if (!this->isValid(handle)) {
+        return;
+    }
+    unsigned int index = this->indices[handle], last = this->handles.size() - 1;
+    if (this->parents[index] != INVALID_TRANSFORM) {
+        this->childCount--;
+    }
+    //the children are after their parent unless a reparenting has not been sorted yet
+    for (unsigned int i = this->orderChanged ? 0 : index + 1; i <= last && this->childCount > 0; i++) {
+        if (this->parents[i] == index) {
+            this->parents[i] = INVALID_TRANSFORM;
+            this->childCount--;
+            this->markDirty(this->handles[i]);
+        }
+    }
+    vector<float>* fields[] = { &this->positionX, &this->positionY, &this->positionZ, &this->scaleX, &this->scaleY, &this->scaleZ,
+        &this->axisX, &this->axisY, &this->axisZ, &this->angle };
+    for (vector<float>* field : fields) {
+        (*field)[index] = (*field)[last];
+        field->pop_back();
+    }
+    this->parents[index] = this->parents[last];
+    this->parents.pop_back();
+    this->localMatrices[index] = this->localMatrices[last];
+    this->localMatrices.pop_back();
+    this->modelMatrices[index] = this->modelMatrices[last];
+    this->modelMatrices.pop_back();
+    this->normalMatrices[index] = this->normalMatrices[last];
+    this->normalMatrices.pop_back();
+    this->dirty[index] = this->dirty[last];
+    this->dirty.pop_back();
+    transformHandle moved = this->handles[last];
+    this->handles[index] = moved;
+    this->indices[moved] = index;
+    this->handles.pop_back();
+    this->indices[handle] = INVALID_TRANSFORM;
+    this->freeHandles.push_back(handle);
+    if (index == last) {
+        return;
+    }
+    //in order the last transform has no children, it only has to stay after its parent
+    if (this->orderChanged) {
+        for (unsigned int& parent : this->parents) {
+            if (parent == last) {
+                parent = index;
+            }
+        }
+    }
+    if (this->parents[index] != INVALID_TRANSFORM && this->parents[index] > index) {
+        this->orderChanged = true;
+    }
+}
+
+void transformStore::clear() {
+    vector<float>* fields[] = { &this->positionX, &this->positionY, &this->positionZ, &this->scaleX, &this->scaleY, &this->scaleZ,
+        &this->axisX, &this->axisY, &this->axisZ, &this->angle };
+    for (vector<float>* field : fields) {
+        field->clear();
+    }
+    this->parents.clear();
+    this->localMatrices.clear();
+    this->modelMatrices.clear();
+    this->normalMatrices.clear();
+    this->changedIndices.clear();
+    this->dirty.clear();
+    this->dirtyHandles.clear();
+    this->indices.clear();
+    this->handles.clear();
+    this->freeHandles.clear();
+    this->childCount = 0;
+    this->orderChanged = false;
+}
+
+bool transformStore::isValid(transformHandle handle) {
+    return handle < this->indices.size() && this->indices[handle] != INVALID_TRANSFORM;
+}
+
+glm::vec3 transformStore::getPosition(transformHandle handle) {
+    unsigned int i = this->indices[handle];
+    return glm::vec3(this->positionX[i], this->positionY[i], this->positionZ[i]);
+}
+glm::vec3 transformStore::getScale(transformHandle handle) {
+    unsigned int i = this->indices[handle];
+    return glm::vec3(this->scaleX[i], this->scaleY[i], this->scaleZ[i]);
+}
+glm::vec3 transformStore::getRotationAxis(transformHandle handle) {
+    unsigned int i = this->indices[handle];
+    return glm::vec3(this->axisX[i], this->axisY[i], this->axisZ[i]);
+}
+float transformStore::getRotationAngle(transformHandle handle) {
+    return this->angle[this->indices[handle]];
+}
+transformHandle transformStore::getParent(transformHandle handle) {
+    unsigned int parent = this->parents[this->indices[handle]];
+    return parent == INVALID_TRANSFORM ? INVALID_TRANSFORM : this->handles[parent];
+}
+bool transformStore::setParent(transformHandle handle, transformHandle parent) {
+    unsigned int i = this->indices[handle];
+    unsigned int p = parent == INVALID_TRANSFORM ? INVALID_TRANSFORM : this->indices[parent];
+    for (unsigned int ancestor = p; ancestor != INVALID_TRANSFORM; ancestor = this->parents[ancestor]) {
+        if (ancestor == i) {
+            return false;
+        }
+    }
+    if (this->parents[i] == INVALID_TRANSFORM && p != INVALID_TRANSFORM) {
+        this->childCount++;
+    }
+    else if (this->parents[i] != INVALID_TRANSFORM && p == INVALID_TRANSFORM) {
+        this->childCount--;
+    }
+    this->parents[i] = p;
+    if (p != INVALID_TRANSFORM && p > i) {
+        this->orderChanged = true;
+    }
+    this->markDirty(handle);
+    return true;
+}
+void transformStore::setPosition(transformHandle handle, const glm::vec3& position) {
+    unsigned int i = this->indices[handle];
+    this->positionX[i] = position.x;
+    this->positionY[i] = position.y;
+    this->positionZ[i] = position.z;
+    this->markDirty(handle);
+}
+void transformStore::setScale(transformHandle handle, const glm::vec3& scale) {
+    unsigned int i = this->indices[handle];
+    this->scaleX[i] = scale.x;
+    this->scaleY[i] = scale.y;
+    this->scaleZ[i] = scale.z;
+    this->markDirty(handle);
+}
+void transformStore::setRotation(transformHandle handle, const glm::vec3& axis, float angle) {
+    unsigned int i = this->indices[handle];
+    this->axisX[i] = axis.x;
+    this->axisY[i] = axis.y;
+    this->axisZ[i] = axis.z;
+    this->angle[i] = angle;
+    this->markDirty(handle);
+}
+
+void transformStore::markDirty(transformHandle handle) {
+    unsigned int i = this->indices[handle];
+    if (this->dirty[i] != LOCAL_DIRTY) {
+        this->dirty[i] = LOCAL_DIRTY;
+        this->dirtyHandles.push_back(handle);
+    }
+}
+
+unsigned int transformStore::updateModelMatrices() {
+    if (this->orderChanged) {
+        this->sortParentsFirst();
+    }
+    this->changedIndices.clear();
+    if (this->dirtyHandles.empty()) {
+        return 0;
+    }
+    trsArrays arrays = this->getArrays();
+    if (this->childCount == 0) {
+        //no hierarchy, the world matrices are the local ones
+        for (transformHandle handle : this->dirtyHandles) {
+            if (this->isValid(handle) && this->dirty[this->indices[handle]]) {
+                this->dirty[this->indices[handle]] = 0;
+                this->changedIndices.push_back(this->indices[handle]);
+            }
+        }
+        this->dirtyHandles.clear();
+        composeModelMatrices(&arrays, this->changedIndices.data(), this->changedIndices.size(), this->localMatrices.data());
+        for (unsigned int i : this->changedIndices) {
+            this->modelMatrices[i] = this->localMatrices[i];
+            this->normalMatrices[i] = computeNormalMatrix(this->modelMatrices[i]);
+        }
+        return this->changedIndices.size();
+    }
+    //the changed local matrices are composed in one batch, the world ones then need the matrices of their parents
+    unsigned int count = this->size(), first = count;
+    this->composeIndices.clear();
+    for (transformHandle handle : this->dirtyHandles) {
+        if (this->isValid(handle) && this->dirty[this->indices[handle]] == LOCAL_DIRTY) {
+            unsigned int i = this->indices[handle];
+            this->dirty[i] = WORLD_DIRTY;
+            this->composeIndices.push_back(i);
+            first = min(first, i);
+        }
+    }
+    this->dirtyHandles.clear();
+    composeModelMatrices(&arrays, this->composeIndices.data(), this->composeIndices.size(), this->localMatrices.data());
+    //forward pass from the first dirty transform, a parent is always recomputed before its children
+    //so the dirty flags spread down the changed subtrees and everything else is skipped
+    const unsigned int* parents = this->parents.data();
+    unsigned char* dirty = this->dirty.data();
+    for (unsigned int i = first; i < count; i++) {
+        unsigned int parent = parents[i];
+        if (parent != INVALID_TRANSFORM && dirty[parent]) {
+            //the siblings that follow all change with their parent, they go through the batch product together
+            unsigned int end = i + 1;
+            while (end < count && parents[end] == parent) {
+                end++;
+            }
+            multiplyMatrices(this->modelMatrices[parent], &this->localMatrices[i], end - i, &this->modelMatrices[i]);
+            for (unsigned int j = i; j < end; j++) {
+                dirty[j] = WORLD_DIRTY;
+                this->changedIndices.push_back(j);
+            }
+            i = end - 1;
+            continue;
+        }
+        if (!dirty[i]) {
+            continue;
+        }
+        if (parent == INVALID_TRANSFORM) {
+            this->modelMatrices[i] = this->localMatrices[i];
+        }
+        else {
+            multiplyMatrices(this->modelMatrices[parent], &this->localMatrices[i], 1, &this->modelMatrices[i]);
+        }
+        this->changedIndices.push_back(i);
+    }
+    for (unsigned int i : this->changedIndices) {
+        dirty[i] = 0;
+        this->normalMatrices[i] = computeNormalMatrix(this->modelMatrices[i]);
+    }
+    return this->changedIndices.size();
+}
+
+void transformStore::sortParentsFirst() {
+    unsigned int count = this->size();
+    vector<unsigned int> order;
+    order.reserve(count);
+    vector<unsigned char> placed(count, 0);
+    vector<unsigned int> ancestors;
+    for (unsigned int i = 0; i < count; i++) {
+        //the ancestors not placed yet go first, the oldest one first
+        for (unsigned int a = i; a != INVALID_TRANSFORM && !placed[a]; a = this->parents[a]) {
+            ancestors.push_back(a);
+        }
+        for (auto a = ancestors.rbegin(); a != ancestors.rend(); a++) {
+            placed[*a] = 1;
+            order.push_back(*a);
+        }
+        ancestors.clear();
+    }
+    vector<unsigned int> newIndices(count);
+    for (unsigned int n = 0; n < count; n++) {
+        newIndices[order[n]] = n;
+    }
+    vector<float>* fields[] = { &this->positionX, &this->positionY, &this->positionZ, &this->scaleX, &this->scaleY, &this->scaleZ,
+        &this->axisX, &this->axisY, &this->axisZ, &this->angle };
+    for (vector<float>* field : fields) {
+        permute(field, order);
+    }
+    permute(&this->parents, order);
+    permute(&this->localMatrices, order);
+    permute(&this->modelMatrices, order);
+    permute(&this->normalMatrices, order);
+    permute(&this->dirty, order);
+    permute(&this->handles, order);
+    for (unsigned int& parent : this->parents) {
+        if (parent != INVALID_TRANSFORM) {
+            parent = newIndices[parent];
+        }
+    }
+    for (unsigned int n = 0; n < count; n++) {
+        this->indices[this->handles[n]] = n;
+    }
+    this->orderChanged = false;
+}
+
+void transformStore::buildModelMatrices(glm::mat4* matrices) {
+    trsArrays arrays = this->getArrays();
+    composeModelMatrices(&arrays, NULL, this->size(), matrices);
+}
+
+trsArrays transformStore::getArrays() {
+    trsArrays arrays;
+    arrays.positionX = this->positionX.data();
+    arrays.positionY = this->positionY.data();
+    arrays.positionZ = this->positionZ.data();
+    arrays.scaleX = this->scaleX.data();
+    arrays.scaleY = this->scaleY.data();
+    arrays.scaleZ = this->scaleZ.data();
+    arrays.axisX = this->axisX.data();
+    arrays.axisY = this->axisY.data();
+    arrays.axisZ = this->axisZ.data();
+    arrays.angle = this->angle.data();
+    return arrays;
+}
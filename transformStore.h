@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "batchMath.h"
+
+using namespace std;
+
+typedef unsigned int transformHandle;
+#define INVALID_TRANSFORM 0xffffffffu
+
+//position, scale and rotation of many items in structure of arrays form, packed so that per frame passes read them linearly
+//handles stay valid until destroyed, the dense index of a transform only moves when another one is destroyed or reparented
+//a transform can have a parent whose model matrix applies on top of its own, parents always come before their children
+//in the arrays so that the world matrices are propagated in one forward pass
+//the model matrices are cached, only the transforms changed since the last updateModelMatrices and their descendants are recomputed
+class transformStore {
+public:
+    vector<float> positionX;
+    vector<float> positionY;
+    vector<float> positionZ;
+    vector<float> scaleX;
+    vector<float> scaleY;
+    vector<float> scaleZ;
+    vector<float> axisX;
+    vector<float> axisY;
+    vector<float> axisZ;
+    vector<float> angle;
+    vector<unsigned int> parents;           // dense index of the parent of each transform, INVALID_TRANSFORM for the roots
+    vector<glm::mat4> localMatrices;        // relative to the parent
+    vector<glm::mat4> modelMatrices;        // world matrices in dense order, valid after updateModelMatrices
+    vector<glm::mat3> normalMatrices;       // inverse transpose of their upper 3x3, recomputed with them, for the normals
+    vector<unsigned int> changedIndices;    // dense indices of the matrices recomputed by the last updateModelMatrices
+
+    transformStore() : childCount(0), orderChanged(false) {}
+    transformHandle create(const glm::vec3& position = glm::vec3(0.f), const glm::vec3& scale = glm::vec3(1.f),
+        const glm::vec3& rotationAxis = glm::vec3(0.f, 1.f, 0.f), float rotationAngle = 0.f, transformHandle parent = INVALID_TRANSFORM);
+    //the last transform takes the place of the destroyed one, the children of the destroyed one become roots
+    void destroy(transformHandle handle);
+    void clear();
+    bool isValid(transformHandle handle);
+    unsigned int size() {
+        return this->handles.size();
+    }
+    unsigned int getIndex(transformHandle handle) {
+        return this->indices[handle];
+    }
+    transformHandle getHandle(unsigned int index) {
+        return this->handles[index];
+    }
+    transformHandle getParent(transformHandle handle);
+    //INVALID_TRANSFORM makes it a root, false if parent is the transform itself or one of its descendants
+    //a parent placed after the transform reorders the arrays at the next updateModelMatrices
+    bool setParent(transformHandle handle, transformHandle parent);
+    glm::vec3 getPosition(transformHandle handle);
+    glm::vec3 getScale(transformHandle handle);
+    glm::vec3 getRotationAxis(transformHandle handle);
+    float getRotationAngle(transformHandle handle);
+    void setPosition(transformHandle handle, const glm::vec3& position);
+    void setScale(transformHandle handle, const glm::vec3& scale);
+    void setRotation(transformHandle handle, const glm::vec3& axis, float angle);
+    //recomputes the model matrices of the transforms created or changed since the last call and of their descendants, returns their count
+    unsigned int updateModelMatrices();
+    //translate(-position) * rotate(angle, axis) * scale(scale) of every transform in dense order, in one pass, ignoring the parents
+    //gives the same matrices as the glm calls
+    void buildModelMatrices(glm::mat4* matrices);
+private:
+    vector<unsigned char> dirty;            // of each dense index, LOCAL_DIRTY or WORLD_DIRTY when it has to be recomputed
+    vector<transformHandle> dirtyHandles;   // may hold destroyed or already recomputed handles, checked against dirty
+    vector<unsigned int> indices;           // dense index of each handle, INVALID_TRANSFORM once destroyed
+    vector<transformHandle> handles;        // handle of each dense index
+    vector<transformHandle> freeHandles;
+    vector<unsigned int> composeIndices;    // local matrices to recompute, gathered for the batch kernel
+    unsigned int childCount;                // transforms with a parent, none means a flat list where only the dirty ones are visited
+    bool orderChanged;                      // a parent may be after one of its children
+
+    void markDirty(transformHandle handle);
+    trsArrays getArrays();
+    //stable reorder that moves each parent before its children when it was after them
+    void sortParentsFirst();
+};
@@ -0,0 +1,20 @@
+#include "uniformBuffer.h"
+
+static_assert(sizeof(frameUniformData) == 176, "frameUniformData must match the std140 layout of the frameData block");
+
+void frameUniformBuffer::create() {
+    glGenBuffers(1, &this->buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frameUniformData), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, this->buffer);
+}
+
+void frameUniformBuffer::update(const frameUniformData* data) {
+    glBindBuffer(GL_UNIFORM_BUFFER, this->buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frameUniformData), data);
+}
+
+void frameUniformBuffer::destroy() {
+    glDeleteBuffers(1, &this->buffer);
+    this->buffer = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <glm/glm.hpp>
+
+//binding point of the frameData block, every program built by shader::build is bound to it
+#define FRAME_UNIFORM_BINDING 0
+#define FRAME_UNIFORM_BLOCK_NAME "frameData"
+
+//mirror of the std140 frameData block declared in the shaders, member order and padding must match
+struct frameUniformData {
+    glm::mat4 viewMatrix;   // offset 0
+    glm::mat4 projMatrix;   // 64
+    glm::vec3 camPos;       // 128, a vec3 is 16 bytes aligned and ratio fills its last 4 bytes
+    float ratio;            // 140
+    float time;             // 144
+    float normalSize;       // 148
+    int showNormals;        // 152
+    int showVertexIndices;  // 156
+    int showVertices;       // 160
+    int showBackSideEdges;  // 164
+    int padding[2];         // blocks are rounded up to a multiple of 16 bytes
+}typedef frameUniformData;
+
+//per frame values shared by all the programs, uploaded with a single buffer write
+class frameUniformBuffer {
+public:
+    unsigned int buffer;
+    frameUniformBuffer() : buffer(0) {}
+    void create();
+    void update(const frameUniformData* data);
+    void destroy();
+};
@@ -1,23 +1,60 @@
 #version 330 core
+//SHOW_NORMALS : geometryShader.glsl follows and reads the VS_OUT block, otherwise the outputs go straight to fragmentShader.glsl
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec2 aTexCoord;
+//per instance attributes, only read when instanced == 1
+layout (location = 2) in mat4 instanceModelMatrix;
+layout (location = 6) in vec4 instanceEdgesColor;
+layout (location = 7) in vec3 aNormal;
+layout (location = 8) in mat3 instanceNormalMatrix;
 
+#ifdef SHOW_NORMALS
 out VS_OUT {
     vec2 TexCoord;
-    int vertexIndex;
     vec4 pos3d;
+    vec4 edgesColor;
+    vec3 normal;
 } vs_out;
+#else
+out vec2 TexCoord;
+out vec3 normal;
+flat out vec4 edgesColor;
+#endif
 
-uniform float time;
+layout (std140) uniform frameData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec3 camPos;
+    float ratio;
+    float time;
+    float normalSize;
+    int showNormals;
+    int showVertexIndices;
+    int showVertices;
+    int showBackSideEdges;
+};
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
+//inverse transpose of mat3(modelMatrix), computed once per transform by transformStore
+uniform mat3 normalMatrix;
+uniform vec4 itemEdgesColor;
+uniform int instanced;
 void main()
 {
     
+    mat4 model = instanced == 1 ? instanceModelMatrix : modelMatrix;
+    vec4 color = instanced == 1 ? instanceEdgesColor : itemEdgesColor;
+    vec4 pos3d = model*vec4(pos.x, pos.y, pos.z, 1.0);
+    //inverse transpose so that non uniform scales keep the normal orthogonal to the surface
+    vec3 worldNormal = normalize((instanced == 1 ? instanceNormalMatrix : normalMatrix)*aNormal);
+#ifdef SHOW_NORMALS
     vs_out.TexCoord = aTexCoord;
-    vs_out.vertexIndex = gl_VertexID;
-    vec4 pos3d = modelMatrix*vec4(pos.x, pos.y, pos.z, 1.0);
+    vs_out.edgesColor = color;
     vs_out.pos3d = pos3d;
+    vs_out.normal = worldNormal;
+#else
+    TexCoord = aTexCoord;
+    edgesColor = color;
+    normal = worldNormal;
+#endif
     gl_Position = projMatrix*viewMatrix*pos3d;
-}
\ No newline at end of file
+}